@@ -0,0 +1,154 @@
+/**
+ * @file aging.c
+ * @brief This module implements the aging kernels. See aging.h.
+ *
+ * The vector width is selected at compile time: AVX2 if the compiler has been
+ * told so (e.g. -mavx2), otherwise SSE2, which is always present on x86_64. 
+ * Other architectures use the scalar code only.
+ */
+
+#include <sched.h>
+#include "aging.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define AGING_STEP_BLOCK 256 //!< Number of reference bits aging_step takes at once
+
+#if defined(__AVX2__)
+#define AGING_VLEN 32 //!< Number of frames per vector
+#elif defined(__SSE2__)
+#define AGING_VLEN 16 //!< Number of frames per vector
+#endif
+
+void aging_lock(int *lock) {
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(lock, __ATOMIC_RELAXED)) {
+            sched_yield(); // the holder may be preempted: don't burn its time slice
+        }
+    }
+}
+
+void aging_unlock(int *lock) {
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+void aging_tick(unsigned char *age, unsigned char *ref, int n) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    __m256i low7 = _mm256_set1_epi8(0x7f);
+    for (; i + AGING_VLEN <= n; i += AGING_VLEN) {
+        __m256i a = _mm256_loadu_si256((__m256i *) (age + i));
+        __m256i r = _mm256_loadu_si256((__m256i *) (ref + i));
+        a = _mm256_and_si256(_mm256_srli_epi16(a, 1), low7); // no byte shift: mask bits of neighbour
+        _mm256_storeu_si256((__m256i *) (age + i), _mm256_or_si256(a, r));
+        _mm256_storeu_si256((__m256i *) (ref + i), _mm256_setzero_si256());
+    }
+#elif defined(__SSE2__)
+    __m128i low7 = _mm_set1_epi8(0x7f);
+    for (; i + AGING_VLEN <= n; i += AGING_VLEN) {
+        __m128i a = _mm_loadu_si128((__m128i *) (age + i));
+        __m128i r = _mm_loadu_si128((__m128i *) (ref + i));
+        a = _mm_and_si128(_mm_srli_epi16(a, 1), low7); // no byte shift: mask bits of neighbour
+        _mm_storeu_si128((__m128i *) (age + i), _mm_or_si128(a, r));
+        _mm_storeu_si128((__m128i *) (ref + i), _mm_setzero_si128());
+    }
+#endif
+    for (; i < n; i++) {
+        age[i] = (age[i] >> 1) | ref[i];
+        ref[i] = 0;
+    }
+}
+
+void aging_step(int *lock, unsigned char *age, unsigned char *ref, int n) {
+    unsigned char bits[AGING_STEP_BLOCK];
+    int i, k, c;
+
+    aging_lock(lock);
+    for (i = 0; i < n; i += c) {
+        c = (n - i < AGING_STEP_BLOCK) ? n - i : AGING_STEP_BLOCK;
+        for (k = 0; k < c; k++) {
+            bits[k] = __atomic_exchange_n(&ref[i + k], 0, __ATOMIC_RELAXED);
+        }
+        aging_tick(age + i, bits, c);
+    }
+    aging_unlock(lock);
+}
+
+int aging_find_min(const unsigned char *age, int n) {
+    int i = 0;
+    int min = 0xff;
+#ifdef AGING_VLEN
+    int nv = n - n % AGING_VLEN; // frames [0, nv) are handled by vectors
+#else
+    int nv = 0;
+#endif
+
+#if defined(__AVX2__)
+    if (nv > 0) {
+        __m256i m = _mm256_set1_epi8((char) 0xff);
+        __m128i h;
+        for (i = 0; i < nv; i += AGING_VLEN) {
+            m = _mm256_min_epu8(m, _mm256_loadu_si256((__m256i *) (age + i)));
+        }
+        h = _mm_min_epu8(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+        h = _mm_min_epu8(h, _mm_srli_si128(h, 8));
+        h = _mm_min_epu8(h, _mm_srli_si128(h, 4));
+        h = _mm_min_epu8(h, _mm_srli_si128(h, 2));
+        h = _mm_min_epu8(h, _mm_srli_si128(h, 1));
+        min = _mm_cvtsi128_si32(h) & 0xff;
+    }
+#elif defined(__SSE2__)
+    if (nv > 0) {
+        __m128i h = _mm_set1_epi8((char) 0xff);
+        for (i = 0; i < nv; i += AGING_VLEN) {
+            h = _mm_min_epu8(h, _mm_loadu_si128((__m128i *) (age + i)));
+        }
+        h = _mm_min_epu8(h, _mm_srli_si128(h, 8));
+        h = _mm_min_epu8(h, _mm_srli_si128(h, 4));
+        h = _mm_min_epu8(h, _mm_srli_si128(h, 2));
+        h = _mm_min_epu8(h, _mm_srli_si128(h, 1));
+        min = _mm_cvtsi128_si32(h) & 0xff;
+    }
+#endif
+    for (i = nv; i < n; i++) {
+        if (age[i] < min) {
+            min = age[i];
+        }
+    }
+
+    /* Ties: the scalar algorithm took the last frame with the smallest age, so search backwards. */
+    for (i = n - 1; i >= nv; i--) {
+        if (age[i] == min) {
+            return i;
+        }
+    }
+#if defined(__AVX2__)
+    {
+        __m256i v = _mm256_set1_epi8((char) min);
+        for (i = nv - AGING_VLEN; i >= 0; i -= AGING_VLEN) {
+            unsigned int mask = _mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i *) (age + i)), v));
+            if (mask != 0) {
+                return i + 31 - __builtin_clz(mask);
+            }
+        }
+    }
+#elif defined(__SSE2__)
+    {
+        __m128i v = _mm_set1_epi8((char) min);
+        for (i = nv - AGING_VLEN; i >= 0; i -= AGING_VLEN) {
+            unsigned int mask = _mm_movemask_epi8(
+                    _mm_cmpeq_epi8(_mm_loadu_si128((__m128i *) (age + i)), v));
+            if (mask != 0) {
+                return i + 31 - __builtin_clz(mask);
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
+// EOF
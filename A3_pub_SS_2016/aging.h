@@ -0,0 +1,89 @@
+/**
+ * @file aging.h
+ * @brief Header file of the aging kernels.
+ *
+ * The ages and reference bits of the frames are stored as packed byte arrays
+ * in struct pt_struct (frame_age, frame_ref). A reference bit is stored as 0x80,
+ * so one aging step is age = (age >> 1) | ref for each frame. Both kernels
+ * process 32 (AVX2) or 16 (SSE2) frames per instruction and handle the 
+ * remaining frames with scalar code.
+ * Several threads of several clients do aging steps, and mmanage sets the age of
+ * a frame when it loads a page, so the ages are protected by a spin lock in
+ * shared memory (aging_lock). The reference bits are set without the lock.
+ */
+
+#ifndef AGING_H
+#define AGING_H
+
+#define AGING_REF 0x80 //!< Value of a set reference bit in frame_ref 
+
+/**
+ *****************************************************************************************
+ *  @brief      This function acquires a spin lock of the ages. The lock may be located 
+ *              in shared memory, so it serializes all processes.
+ *
+ *  @param      lock The lock, 0 if it is free.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void aging_lock(int *lock);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function releases a spin lock acquired by aging_lock.
+ *
+ *  @param      lock The lock.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void aging_unlock(int *lock);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function does one aging step: each age will be shifted right by
+ *              one bit, the reference bit will be or'ed into the most significant bit
+ *              and will be reset.
+ *
+ *  @param      age Ages of n frames.
+ *
+ *  @param      ref Reference bits of n frames (0 or AGING_REF).
+ *
+ *  @param      n Number of frames.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void aging_tick(unsigned char *age, unsigned char *ref, int n);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function does one aging step of ages that are shared by several 
+ *              threads: the reference bits will be taken by atomic exchanges, so bits
+ *              set during the step are kept for the next step, and the ages will be 
+ *              changed while holding the lock.
+ *
+ *  @param      lock Lock of the ages, see aging_lock.
+ *
+ *  @param      age Ages of n frames.
+ *
+ *  @param      ref Reference bits of n frames (0 or AGING_REF).
+ *
+ *  @param      n Number of frames.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void aging_step(int *lock, unsigned char *age, unsigned char *ref, int n);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function finds the frame with the smallest age. 
+ *              If several frames have the smallest age, the last one will be returned.
+ *
+ *  @param      age Ages of n frames.
+ *
+ *  @param      n Number of frames. n must be > 0.
+ *
+ *  @return     idx of the frame with the smallest age.
+ ****************************************************************************************/
+int aging_find_min(const unsigned char *age, int n);
+
+#endif /* AGING_H */
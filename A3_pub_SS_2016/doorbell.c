@@ -0,0 +1,71 @@
+/**
+ * @file doorbell.c
+ * @brief This module implements a doorbell based on the Linux futex system call.
+ *        See doorbell.h for the protocol.
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include "debug.h"
+#include "mytypes.h"
+#include "doorbell.h"
+
+/**
+ * CPU hint used while polling a doorbell.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#endif
+
+static void futex_wait(int *bell, int val) {
+    /* The doorbell lives in shared memory, so FUTEX_PRIVATE_FLAG must not be used. */
+    if (syscall(SYS_futex, bell, FUTEX_WAIT, val, NULL, NULL, 0) == -1) {
+        TEST_AND_EXIT_ERRNO(errno != EAGAIN && errno != EINTR, "futex wait failed");
+    }
+}
+
+static void futex_wake(int *bell) {
+    TEST_AND_EXIT_ERRNO(syscall(SYS_futex, bell, FUTEX_WAKE, 1, NULL, NULL, 0) == -1,
+                        "futex wake failed");
+}
+
+void doorbell_ring(int *bell) {
+    if (__atomic_exchange_n(bell, DOORBELL_RUNG, __ATOMIC_RELEASE) == DOORBELL_SLEEPING) {
+        futex_wake(bell);
+    }
+}
+
+void doorbell_wait(int *bell, int *spin, int spin_max) {
+    int i;
+    int expected;
+
+    for (i = 0; i < *spin; i++) {
+        if (__atomic_load_n(bell, __ATOMIC_ACQUIRE) == DOORBELL_RUNG) {
+            __atomic_store_n(bell, DOORBELL_IDLE, __ATOMIC_RELAXED);
+            *spin = (*spin * 2 > spin_max) ? spin_max : *spin * 2;
+            return;
+        }
+        CPU_RELAX();
+    }
+    *spin = (*spin / 2 > 0 || spin_max == 0) ? *spin / 2 : 1;
+
+    while (1) {
+        if (__atomic_load_n(bell, __ATOMIC_ACQUIRE) == DOORBELL_RUNG) {
+            __atomic_store_n(bell, DOORBELL_IDLE, __ATOMIC_RELAXED);
+            return;
+        }
+        expected = DOORBELL_IDLE;
+        __atomic_compare_exchange_n(bell, &expected, DOORBELL_SLEEPING, FALSE,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+        if (expected == DOORBELL_RUNG) {
+            continue;
+        }
+        futex_wait(bell, DOORBELL_SLEEPING);
+    }
+}
+
+// EOF
@@ -0,0 +1,48 @@
+/**
+ * @file doorbell.h
+ * @brief Header file of the futex based doorbell module.
+ *
+ * A doorbell is an int located in shared memory. One process rings it,
+ * exactly one other process waits for it. It is used as an alternative
+ * to the SIGUSR1 / named semaphore round trip between vmaccess and mmanage.
+ * A waiter may poll the doorbell for a while before it goes to sleep in
+ * the kernel. The number of polls adapts to the observed response time.
+ */
+
+#ifndef DOORBELL_H
+#define DOORBELL_H
+
+#define DOORBELL_IDLE     0 //!< Doorbell not rung, nobody sleeps on it
+#define DOORBELL_RUNG     1 //!< Doorbell rung, not yet consumed by the waiter
+#define DOORBELL_SLEEPING 2 //!< Waiter sleeps in the kernel and must be woken up
+
+/**
+ *****************************************************************************************
+ *  @brief      This function rings a doorbell. The waiter will be woken up by a futex
+ *              system call only if it is sleeping in the kernel.
+ *
+ *  @param      bell Pointer to the doorbell in shared memory.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void doorbell_ring(int *bell);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function waits until a doorbell has been rung and resets it.
+ *
+ *  The waiter polls the doorbell up to *spin times before it sleeps in the kernel.
+ *  When the doorbell was rung while polling, *spin will be doubled (limited by
+ *  spin_max), otherwise it will be halved.
+ *
+ *  @param      bell Pointer to the doorbell in shared memory.
+ *
+ *  @param      spin Current adaptive number of polls. Will be updated.
+ *
+ *  @param      spin_max Upper limit of *spin. 0 disables polling.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void doorbell_wait(int *bell, int *spin, int spin_max);
+
+#endif /* DOORBELL_H */
@@ -0,0 +1,72 @@
+/**
+ * @file instance.c
+ * @brief This module derives the names of all shared objects of a simulation
+ *        from its instance id. See instance.h.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/ipc.h>
+#include "debug.h"
+#include "vmem.h"
+#include "instance.h"
+
+static char instance_id[INSTANCE_MAXLEN + 1] = ""; //!< Instance id; "" : no instance id
+static int initialized = FALSE;                    //!< TRUE: instance_id has been set
+
+void instance_init(const char *id) {
+    if (id == NULL && initialized) {
+        return;
+    }
+    if (id == NULL) {
+        id = getenv(INSTANCE_ENV);
+    }
+    if (id == NULL) {
+        id = "";
+    }
+    TEST_AND_EXIT(strlen(id) > INSTANCE_MAXLEN, (stderr, "instance id %s too long\n", id));
+    TEST_AND_EXIT(strchr(id, '/') != NULL, (stderr, "instance id %s must not contain '/'\n", id));
+    strcpy(instance_id, id);
+    initialized = TRUE;
+}
+
+key_t instance_shm_key(void) {
+    key_t key = ftok(SHMKEY, SHMPROCID);
+    unsigned int hash = 2166136261u; // FNV-1a
+    const char *c;
+
+    TEST_AND_EXIT_ERRNO(key == -1, "ftok");
+    if (instance_id[0] == '\0') {
+        return key;
+    }
+    for (c = instance_id; *c != '\0'; c++) {
+        hash = (hash ^ (unsigned char) *c) * 16777619u;
+    }
+    key ^= (key_t) (hash & 0x7fffffff);
+    return (key == IPC_PRIVATE || key == -1) ? 1 : key;
+}
+
+char *instance_name(const char *name, char *buf, size_t len) {
+    const char *ext = strrchr(name, '.');
+
+    if (instance_id[0] == '\0') {
+        snprintf(buf, len, "%s", name);
+    } else if (ext == NULL || strchr(ext, '/') != NULL || ext == name) {
+        snprintf(buf, len, "%s_%s", name, instance_id);
+    } else {
+        snprintf(buf, len, "%.*s_%s%s", (int) (ext - name), name, instance_id, ext);
+    }
+    return buf;
+}
+
+char *instance_client_name(const char *name, int asid, char *buf, size_t len) {
+    size_t n = strlen(instance_name(name, buf, len));
+
+    if (asid > 0 && n < len) {
+        snprintf(buf + n, len - n, "_c%d", asid);
+    }
+    return buf;
+}
+
+// EOF
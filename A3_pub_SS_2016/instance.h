@@ -0,0 +1,78 @@
+/**
+ * @file instance.h
+ * @brief Header file of the instance module.
+ *
+ * Several simulations may run concurrently on one host. Each simulation is 
+ * identified by an instance id. All names of shared objects are derived from
+ * it: shared memory key, named semaphore, pagefile and logfile. 
+ * Without instance id the names defined in vmem.h, pagefile.c and logger.h
+ * are used unchanged.
+ */
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define INSTANCE_ENV     "VMEM_INSTANCE" //!< Environment variable that defines the instance id
+#define INSTANCE_MAXLEN  64              //!< Max. length of an instance id
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sets the instance id.
+ *
+ *  @param      id Instance id. If id is NULL, an instance id set before will be kept.
+ *              Otherwise the environment variable INSTANCE_ENV will be used. If this is
+ *              not defined either, no instance id will be used.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void instance_init(const char *id);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the key of the shared memory of this instance.
+ *
+ *  @return     key of the shared memory (see ftok).
+ ****************************************************************************************/
+key_t instance_shm_key(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function derives the name of an object of this instance.
+ *
+ *  The instance id will be inserted in front of the extension of name:
+ *  "./logfile.txt" becomes "./logfile_<id>.txt". Names without extension get
+ *  the suffix "_<id>".
+ *
+ *  @param      name Name of the object without instance id.
+ *
+ *  @param      buf Buffer for the name of the object of this instance.
+ *
+ *  @param      len Size of buf.
+ *
+ *  @return     buf
+ ****************************************************************************************/
+char *instance_name(const char *name, char *buf, size_t len);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function derives the name of an object of a client of this instance.
+ *
+ *  The object of client 0 has the name of instance_name, so a single client uses
+ *  the names of former versions. Other clients get the suffix "_c<asid>".
+ *
+ *  @param      name Name of the object without instance id.
+ *
+ *  @param      asid ASID of the client, see struct vmem_client.
+ *
+ *  @param      buf Buffer for the name of the object of the client.
+ *
+ *  @param      len Size of buf.
+ *
+ *  @return     buf
+ ****************************************************************************************/
+char *instance_client_name(const char *name, int asid, char *buf, size_t len);
+
+#endif /* INSTANCE_H */
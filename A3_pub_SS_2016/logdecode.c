@@ -0,0 +1,121 @@
+/**
+ * @file logdecode.c
+ * @brief Decoder of binary logfiles.
+ *
+ * mmanage, vmappl -inproc and vmreplay write a binary logfile when started
+ * with -binlog (see logger.h). logdecode prints its events to stdout in the 
+ * text format of logfile.txt, e.g.
+ *
+ *     ./logdecode > logfile.txt
+ */
+
+#include <limits.h>
+#include "vmem.h"
+#include "logger.h"
+#include "instance.h"
+#include "debug.h"
+#include "mytypes.h"
+
+#define DECODE_BLOCK 4096 //!< Number of events read at once
+
+/* 
+ * Signatures of private (static) functions of this module.
+ */
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans all parameters of the program.
+ *              The corresponding static variables will be set.
+ * 
+ *  @param      argc number of parameter 
+ *
+ *  @param      argv parameter list 
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void scan_params(int argc, char **argv);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints an error message and the usage information of 
+ *              this program.
+ *
+ *  @param      err_str pointer to the error string that should be printed.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void print_usage_info_and_exit(char *err_str);
+
+/*
+ * static global variables
+ */
+static char *program_name = NULL;
+static char *log_name     = NULL;  // binary logfile; NULL: logfile.bin of the instance
+
+int main(int argc, char **argv) {
+    static struct logevent le[DECODE_BLOCK];
+    static char outbuf[1 << 16];
+    struct logheader h;
+    char name[PATH_MAX];
+    FILE *f;
+    size_t n, i;
+
+    program_name = argv[0];
+    scan_params(argc, argv);
+    if (log_name == NULL) {
+        instance_init(NULL);
+        log_name = instance_name(MMANAGE_BINLOGFNAME, name, sizeof(name));
+    }
+
+    f = fopen(log_name, "r");
+    TEST_AND_EXIT_ERRNO(!f, "Error opening binary logfile");
+    TEST_AND_EXIT(fread(&h, sizeof(h), 1, f) != 1 || strncmp(h.magic, LOGGER_MAGIC, sizeof(h.magic)) != 0,
+                  (stderr, "%s is not a binary logfile\n", log_name));
+    TEST_AND_EXIT(h.record_size != sizeof(struct logevent), 
+                  (stderr, "%s: unsupported record size %d\n", log_name, h.record_size));
+    setvbuf(stdout, outbuf, _IOFBF, sizeof(outbuf));
+
+    while ((n = fread(le, sizeof(struct logevent), DECODE_BLOCK, f)) > 0) {
+        for (i = 0; i < n && le[i].pf_count != 0; i++) {
+            printf(LOGGER_FORMAT, le[i].pf_count, le[i].g_count, 
+                   le[i].replaced_page, le[i].req_pageno, le[i].alloc_frame);
+        }
+        if (i < n) {
+            break; // pf_count 0: end of the events of a logfile that has not been closed
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+void scan_params(int argc, char **argv) {
+    int i = 0;
+    unsigned char param_ok = FALSE;
+    const char *log_str = "-log=";
+    const char *instance_str = "-instance=";
+
+    // scan all parameters (argv[0] points to program name)
+    for (i = 1; i < argc; i++) {
+        param_ok = FALSE;
+        if (0 == strncasecmp(log_str, argv[i], strlen(log_str))) {
+            log_name = argv[i] + strlen(log_str);
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(instance_str, argv[i], strlen(instance_str))) {
+            instance_init(argv[i] + strlen(instance_str));
+            param_ok = TRUE;
+        }
+        if (!param_ok) print_usage_info_and_exit("Undefined parameter.\n"); // undefined parameter found
+    } // for loop
+}
+
+void print_usage_info_and_exit(char *err_str) {
+    fprintf(stderr, "Wrong parameter: %s\n", err_str);
+    fprintf(stderr, "Usage : %s [OPTIONS]\n", program_name);
+    fprintf(stderr, " -log=<file> : Binary logfile (default %s)\n", MMANAGE_BINLOGFNAME);
+    fprintf(stderr, " -instance=<id> : Instance id; the default logfile will be logfile_<id>.bin\n");
+    fflush(stderr);
+    exit(EXIT_FAILURE);
+}
+
+// EOF
@@ -7,25 +7,98 @@
  *        implementation of Wolfgang Fohl.
  */
 
+#define _GNU_SOURCE // mremap
+#include <limits.h>
+#include <sys/mman.h>
 #include "logger.h"
 #include "debug.h"
+#include "instance.h"
+#include "vmem.h"
+
+#define BINLOG_INITIAL (64 * 1024) //!< Initial capacity of a binary logfile in events
 
 static FILE *logfile = NULL;  //!< Reference to logfile
+static int binary = FALSE;    //!< Binary mode selected
+static int bin_fd = -1;       //!< File descriptor of binary logfile
+static char *bin_map = NULL;  //!< Mapping of binary logfile: struct logheader, then events
+static size_t bin_cap = 0;    //!< Capacity of bin_map in events
+static size_t bin_count = 0;  //!< Number of events in bin_map
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the size of a binary logfile with n events.
+ *
+ *  @param      n Number of events.
+ *
+ *  @return     Size in bytes
+ ****************************************************************************************/
+static size_t bin_size(size_t n) {
+    return sizeof(struct logheader) + n * sizeof(struct logevent);
+}
+
+int logger_option(const char *arg) {
+    if (0 == strcasecmp("-binlog", arg)) {
+        binary = TRUE;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+void logger_usage(void) {
+    fprintf(stderr, " -binlog : Write binary logfile %s, see logdecode\n", MMANAGE_BINLOGFNAME);
+}
 
 void open_logger(void) {
+    char name[PATH_MAX];
+    struct logheader *h;
+
+    if (binary) {
+        bin_fd = open(instance_name(MMANAGE_BINLOGFNAME, name, sizeof(name)), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        TEST_AND_EXIT_ERRNO(bin_fd == -1, "Error creating logfile");
+        bin_cap = BINLOG_INITIAL;
+        bin_count = 0;
+        TEST_AND_EXIT_ERRNO(ftruncate(bin_fd, bin_size(bin_cap)) == -1, "Error resizing logfile");
+        bin_map = mmap(NULL, bin_size(bin_cap), PROT_READ | PROT_WRITE, MAP_SHARED, bin_fd, 0);
+        TEST_AND_EXIT_ERRNO(bin_map == MAP_FAILED, "Error mapping logfile");
+        h = (struct logheader *) bin_map;
+        strncpy(h->magic, LOGGER_MAGIC, sizeof(h->magic));
+        h->record_size = sizeof(struct logevent);
+        h->pagesize = VMEM_PAGESIZE;
+        return;
+    }
     /* Open logfile */
-    logfile = fopen(MMANAGE_LOGFNAME, "w");
+    logfile = fopen(instance_name(MMANAGE_LOGFNAME, name, sizeof(name)), "w");
     TEST_AND_EXIT_ERRNO(!logfile, "Error creating logfile");
 }
 
 void close_logger(void) {
+    if (binary) {
+        TEST_AND_EXIT_ERRNO(munmap(bin_map, bin_size(bin_cap)) == -1, "munmap of logfile failed");
+        TEST_AND_EXIT_ERRNO(ftruncate(bin_fd, bin_size(bin_count)) == -1, "Error truncating logfile");
+        close(bin_fd);
+        return;
+    }
     fclose(logfile);
 }
 
+void log_event(struct logevent le) {
+    if (!binary) {
+        logger(le);
+        return;
+    }
+    if (bin_count == bin_cap) {
+        // double the capacity; amortized there is no system call per event
+        TEST_AND_EXIT_ERRNO(ftruncate(bin_fd, bin_size(2 * bin_cap)) == -1, "Error resizing logfile");
+        bin_map = mremap(bin_map, bin_size(bin_cap), bin_size(2 * bin_cap), MREMAP_MAYMOVE);
+        TEST_AND_EXIT_ERRNO(bin_map == MAP_FAILED, "Error mapping logfile");
+        bin_cap *= 2;
+    }
+    ((struct logevent *) (bin_map + sizeof(struct logheader)))[bin_count++] = le;
+}
+
 /* Do not change!  */
 void logger(struct logevent le) {
-    fprintf(logfile, "Page fault %10d, Global count %10d:\n"
-            "Removed: %10d, Allocated: %10d, Frame: %10d\n",
+    fprintf(logfile, LOGGER_FORMAT,
             le.pf_count, le.g_count,
             le.replaced_page, le.req_pageno, le.alloc_frame);
     fflush(logfile);
@@ -4,6 +4,13 @@
  * @date Dec 2015
  * @brief Header file of the logger module. It is based on the logger function 
  *        of the reference implementation of Wolfgang Fohl.
+ *
+ * In binary mode (-binlog) the events will be appended as struct logevent
+ * to a memory mapped file, so there is no system call per event. The file
+ * starts with a struct logheader. It will be enlarged when it is full and 
+ * truncated to the events written when it is closed. If mmanage did not 
+ * close it, the events end at the first one with pf_count 0.
+ * logdecode converts a binary logfile into the text format of logger.
  */
 
 #ifndef LOGGER_H
@@ -21,6 +28,44 @@ struct logevent {
 };
 
 #define MMANAGE_LOGFNAME "./logfile.txt"  //!< logfile name 
+#define MMANAGE_BINLOGFNAME "./logfile.bin" //!< logfile name of binary mode
+#define LOGGER_MAGIC "VMLOG1"              //!< Magic of the header of a binary logfile
+
+/**
+ * Text format of a logevent. Arguments: pf_count, g_count, replaced_page, req_pageno, alloc_frame
+ */
+#define LOGGER_FORMAT "Page fault %10d, Global count %10d:\n" \
+                      "Removed: %10d, Allocated: %10d, Frame: %10d\n"
+
+/**
+ * Header of a binary logfile 
+ */
+struct logheader {
+    char magic[8];     //!< LOGGER_MAGIC
+    int record_size;   //!< sizeof(struct logevent)
+    int pagesize;      //!< VMEM_PAGESIZE of the simulation
+};
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans a command line parameter of the logger module:
+ *
+ *   -binlog : write a binary logfile (MMANAGE_BINLOGFNAME) instead of the text logfile
+ *
+ *  @param      arg The parameter.
+ *
+ *  @return     TRUE if arg is a valid parameter of the logger module, otherwise FALSE.
+ ****************************************************************************************/
+int logger_option(const char *arg);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the usage information of the parameters 
+ *              scanned by logger_option to stderr.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void logger_usage(void);
 
 /**
  *****************************************************************************************
@@ -48,4 +93,15 @@ void close_logger(void);
  ****************************************************************************************/
 void logger(struct logevent le);
 
+/**
+ *****************************************************************************************
+ *  @brief      This function logs a page fault event in the selected mode: 
+ *              by logger or as binary record.
+ *
+ *  @param      le This stucture describes the entity that should be logged.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void log_event(struct logevent le);
+
 #endif /* LOGGER_H */
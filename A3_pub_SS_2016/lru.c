@@ -0,0 +1,68 @@
+/**
+ * @file lru.c
+ * @brief This module implements the intrusive LRU list of frames. See lru.h.
+ */
+
+#include <sched.h>
+#include "lru.h"
+
+void lru_init(struct pt_struct *pt) {
+    int i;
+
+    for (i = 0; i < VMEM_NFRAMES; i++) {
+        pt->lru_prev[i] = VOID_IDX;
+        pt->lru_next[i] = VOID_IDX;
+    }
+    pt->lru_head = VOID_IDX;
+    pt->lru_tail = VOID_IDX;
+    pt->lru_lock = FALSE;
+}
+
+void lru_lock(struct pt_struct *pt) {
+    while (__atomic_exchange_n(&pt->lru_lock, TRUE, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&pt->lru_lock, __ATOMIC_RELAXED)) {
+            sched_yield(); // the holder may be preempted: don't burn its time slice
+        }
+    }
+}
+
+void lru_unlock(struct pt_struct *pt) {
+    __atomic_store_n(&pt->lru_lock, FALSE, __ATOMIC_RELEASE);
+}
+
+void lru_remove(struct pt_struct *pt, int frame) {
+    int prev = pt->lru_prev[frame];
+    int next = pt->lru_next[frame];
+
+    if (prev == VOID_IDX) {
+        pt->lru_head = next;
+    } else {
+        pt->lru_next[prev] = next;
+    }
+    if (next == VOID_IDX) {
+        pt->lru_tail = prev;
+    } else {
+        pt->lru_prev[next] = prev;
+    }
+    pt->lru_prev[frame] = VOID_IDX;
+    pt->lru_next[frame] = VOID_IDX;
+}
+
+void lru_touch(struct pt_struct *pt, int frame) {
+    if (pt->lru_tail == frame) {
+        return; // already most recently used
+    }
+    if (pt->lru_head == frame || pt->lru_prev[frame] != VOID_IDX) {
+        lru_remove(pt, frame);
+    }
+    pt->lru_prev[frame] = pt->lru_tail;
+    pt->lru_next[frame] = VOID_IDX;
+    if (pt->lru_tail == VOID_IDX) {
+        pt->lru_head = frame;
+    } else {
+        pt->lru_next[pt->lru_tail] = frame;
+    }
+    pt->lru_tail = frame;
+}
+
+// EOF
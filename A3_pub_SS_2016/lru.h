@@ -0,0 +1,76 @@
+/**
+ * @file lru.h
+ * @brief Header file of the LRU list module.
+ *
+ * The frames in use are kept in a doubly linked list in order of their last
+ * access. The list is intrusive: the links are stored per frame in 
+ * struct pt_struct (lru_prev, lru_next), so it can be located in shared memory.
+ * vmaccess moves a frame to the tail on each access, mmanage links a frame
+ * when it loads a page and takes the least recently used frame from the 
+ * head. All operations are O(1).
+ * Several clients and mmanage change the list concurrently, so all functions
+ * except lru_init must be called while holding the lock of the list.
+ */
+
+#ifndef LRU_H
+#define LRU_H
+
+#include "vmem.h"
+
+/**
+ *****************************************************************************************
+ *  @brief      This function initializes an empty LRU list.
+ *
+ *  @param      pt Page table that contains the list.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void lru_init(struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function acquires the spin lock of the list. The lock is located in
+ *              shared memory, so it serializes all processes.
+ *
+ *  @param      pt Page table that contains the list.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void lru_lock(struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function releases the spin lock of the list.
+ *
+ *  @param      pt Page table that contains the list.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void lru_unlock(struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function marks a frame as most recently used. The frame will be
+ *              inserted into the list if it is not linked yet.
+ *
+ *  @param      pt Page table that contains the list.
+ *
+ *  @param      frame The frame that has been accessed.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void lru_touch(struct pt_struct *pt, int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function removes a frame from the list. 
+ *
+ *  @param      pt Page table that contains the list.
+ *
+ *  @param      frame The frame to be removed. It must be linked.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void lru_remove(struct pt_struct *pt, int frame);
+
+#endif /* LRU_H */
@@ -10,21 +10,46 @@
  * manage virtual memory management.
  *
  * The memory manager process will be invoked
- * via a SIGUSR1 signal. It maintains the page table
- * and provides the data pages in shared memory.
+ * via a SIGUSR1 signal or, when started with -futex,
+ * via a futex doorbell in shared memory. The signals are blocked in all 
+ * threads and accepted by sigwait (serve_signals), so page faults are never
+ * served by a signal handler. It maintains
+ * the page table and provides the data pages in shared memory.
  *
  * This process starts shared memory, so
  * it has to be started prior to the vmaccess process.
  *
+ * Page fault handling and page replacement are implemented
+ * in mmcore.c.
+ *
+ * When started with -writeback, a cleaner thread writes back dirty
+ * pages that will probably be replaced soon. It will be woken up after
+ * each page fault.
+ *
+ * Up to VMEM_MAXCLIENTS applications may use the memory manager at the same 
+ * time, each with an address space of its own (see struct vmem_client). A page 
+ * fault is posted in the slot of the thread of the client (see struct vmem_thread);
+ * mmanage serves all posted page faults when it is notified and answers each 
+ * thread via the semaphore or doorbell of its slot. -local selects local page
+ * replacement.
+ *
+ * When started with -workers=<n>, a pool of n worker threads serves the page 
+ * faults. The notification (signal or doorbell) just wakes up a worker;
+ * each worker claims one posted page fault at a time and wakes up another worker
+ * before serving it, so page faults of different threads are served concurrently.
  */
 
 #include "mmanage.h"
+#include "mmcore.h"
 #include "debug.h"
+#include "doorbell.h"
+#include "instance.h"
 #include "pagefile.h"
 #include "logger.h"
 #include "vmem.h"
 
 #include <limits.h>
+#include <pthread.h>
 
 /*
  * Signatures of private / static functions
@@ -32,137 +57,131 @@
 
 /**
  *****************************************************************************************
- *  @brief      This function fetchs a page out of the pagefile.
+ *  @brief      This function initializes the virtual memory.
  *
- * It is mainly a wrapper of the corresponding function of module pagefile.c
+ *  In particular it creates the shared memory. The application just attachs to the
+ *  shared memory. A shared memory segment with the key of the instance will be
+ *  removed only if it is stale (see shm_stale); otherwise mmanage terminates.
  *
- *  @param      pt_idx Index of the page that should be fetched.
- * 
  *  @return     void 
  ****************************************************************************************/
-static void fetch_page(int pt_idx);
+static void vmem_init(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function writes a page into the pagefile.
+ *  @brief      This function checks if a shared memory segment has been left by a
+ *              terminated process, e.g. by an mmanage that has been killed.
  *
- * It is mainly a wrapper of the corresponding function of module pagefile.c
+ *  A running mmanage stays attached to its segment, so the segment is stale if no
+ *  process is attached or its creator has terminated.
  *
- *  @param      pt_idx Index of the page that should be written into the pagefile.
- * 
- *  @return     void 
+ *  @param      shmid Id of the shared memory segment.
+ *
+ *  @return     TRUE if the segment may be removed.
  ****************************************************************************************/
-static void store_page(int pt_idx);
+static int shm_stale(int shmid);
 
 /**
  *****************************************************************************************
- *  @brief      This function initializes the virtual memory.
- *
- *  In particular it creates the shared memory. The application just attachs to the
- *  shared memory.
+ *  @brief      This function serves page faults signaled via the futex doorbell
+ *              vmem->adm.pf_request. It never returns; SIGUSR2 and SIGINT are
+ *              handled by serve_signals in a thread of its own.
  *
  *  @return     void 
  ****************************************************************************************/
-static void vmem_init(void);
+static void serve_futex_faults(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function finds an unused frame.
- *
- *  The framepage array of pagetable marks unused frames with VOID_IDX. 
- *  Based on this information find_free_frame searchs in vmem->pt.framepage for the 
- *  free frame with the smallest frame number.
+ *  @brief      This function handles a page fault notification: the posted page faults
+ *              will be served by serve_clients or by the worker threads.
  *
- *  @return     idx of the unused frame with the smallest idx. 
- *              If all frames are in use, VOID_IDX will be returned.
+ *  @return     void 
  ****************************************************************************************/
-static int find_free_frame();
+static void dispatch_faults(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function update the page table for page vmem->adm.req_pageno.
- *              It will be stored in frame.
- *
- *  @param      frame The frame that stores the now allocated page vmem->adm.req_pageno.
+ *  @brief      This function handles the page faults posted by all threads of all clients.
  *
  *  @return     void 
  ****************************************************************************************/
-static void update_pt(int frame);
+static void serve_clients(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function allocates a new page into memory. If all frames are in 
- *              use the corresponding page replacement algorithm will be called.
+ *  @brief      This function handles the page fault posted by a thread and answers it
+ *              the way selected by vmem->adm.fault_notify. The page fault must have 
+ *              been claimed by resetting pf_pending of the thread.
  *
- *  allocate_page gets the requested page via vmem->adm.req_pageno. Please take into
- *  account that allocate_page must update the page table and log the page fault 
- *  as well.
- *  allocate_page does all actions that must be down when the SIGUSR1 signal 
- *  indicates a page fault.
+ *  @param      slot Index of the slot of the thread in vmem->threads.
  *
  *  @return     void 
  ****************************************************************************************/
-static void allocate_page(void);
+static void serve_fault(int slot);
 
 /**
  *****************************************************************************************
- *  @brief      This function is the signal handler attached to system call sigaction
- *              for signal SIGUSR1, SIGUSR2 and SIGINT.
+ *  @brief      This function is the main function of a worker thread. It waits for 
+ *              work_sem and serves posted page faults.
  *
- * These three signals have the same signal handler. Based on the parameter signo the 
- * corresponding action will be started.
+ *  @param      arg Unused.
  *
- *  @param      signo Current signal that has be be handled.
- * 
- *  @return     void 
+ *  @return     Never returns.
  ****************************************************************************************/
-static void sighandler(int signo);
+static void *worker(void *arg);
 
 /**
  *****************************************************************************************
- *  @brief      This function dumps the page table to stderr.
+ *  @brief      This function is the main function of the background cleaner thread.
+ *              It waits for cleaner_wake and writes back dirty pages via mmcore_writeback.
  *
- *  @return     void 
- ****************************************************************************************/
-static void dump_pt(void);
-
-/**
- *****************************************************************************************
- *  @brief      This function implements page replacement algorithm aging.
+ *  @param      arg Unused.
  *
- *  @return     idx of the page that should be replaced.
+ *  @return     Never returns.
  ****************************************************************************************/
-static int find_remove_aging(void);
+static void *cleaner(void *arg);
 
 /**
  *****************************************************************************************
- *  @brief      This function implements page replacement algorithm fifo.
+ *  @brief      This function starts a thread of mmanage. All signals are blocked in the
+ *              new thread.
+ *
+ *  @param      start Main function of the thread.
  *
- *  @return     idx of the page that should be replaced.
+ *  @return     void 
  ****************************************************************************************/
-static int find_remove_fifo(void);
+static void start_thread(void *(*start)(void *));
 
 /**
  *****************************************************************************************
- *  @brief      This function implements page replacement algorithm clock.
+ *  @brief      This function accepts the signals SIGUSR1, SIGUSR2 and SIGINT by
+ *              sigwait and handles them one by one: SIGUSR1 dispatches the posted 
+ *              page faults, SIGUSR2 dumps the page table and SIGINT cleans up and
+ *              terminates mmanage. The signals must be blocked in all threads.
+ *
+ *  Several SIGUSR1 are merged while one is pending; serve_clients serves all
+ *  posted page faults, so none will be lost.
  *
- *  @return     idx of the page that should be replaced.
+ *  @param      arg Unused.
+ * 
+ *  @return     Never returns.
  ****************************************************************************************/
-static int find_remove_clock(void);
+static void *serve_signals(void *arg);
 
 /**
  *****************************************************************************************
- *  @brief      This function selects and starts a page replacement algorithm.
- *
- *  It is just a wrapper for the three page replacement algorithms.
+ *  @brief      This function dumps the page table and the latency histograms
+ *              to stderr.
  *
- *  @return     The idx of the page that should be replaced.
+ *  @return     void 
  ****************************************************************************************/
-static int find_remove_frame(void);
+static void dump_pt(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function cleans up when mmange runs out.
+ *  @brief      This function cleans up when mmange runs out. 
+ *              The latency histograms will be printed to stderr.
  *
  *  @return     void 
  ****************************************************************************************/
@@ -171,7 +190,8 @@ static void cleanup(void) ;
 /**
  *****************************************************************************************
  *  @brief      This function scans all parameters of the porgram.
- *              The corresponding global variables vmem->adm.page_rep_algo will be set.
+ *              The corresponding static variables page_rep_algo, replace_scope,
+ *              fault_notify, spin_max, writeback, workers and instance_param will be set.
  * 
  *  @param      argc number of parameter 
  *
@@ -197,55 +217,66 @@ static void print_usage_info_and_exit(char *err_str);
  */
 
 static struct vmem_struct *vmem = NULL; //!< Reference to shared memory
-static int signal_number = 0;           //!< Number of signal received last
-static sem_t *local_sem;                //!< OS-X Named semaphores will be stored locally due to pointer
+static sem_t *local_sem[VMEM_MAXTHREADS]; //!< OS-X Named semaphores will be stored locally due to pointer; one per thread slot
+static char *program_name = NULL;       //!< Program name
+static unsigned char page_rep_algo = VMEM_ALGO_FIFO;     //!< Page replacement algorithm
+static unsigned char replace_scope = VMEM_SCOPE_GLOBAL;  //!< Scope of page replacement
+static unsigned char fault_notify = VMEM_NOTIFY_SIGNAL;  //!< Page fault notification mode
+static int spin_max = 0;                //!< Max. number of polls of a doorbell
+static char *instance_param = NULL;     //!< Instance id of -instance parameter or NULL
+static int spin = 0;                    //!< Current adaptive number of polls of doorbell pf_request
+static int writeback = 0;               //!< Number of frames examined by the cleaner; 0: no cleaner
+static sem_t cleaner_wake;              //!< Posted after each page fault to wake up the cleaner
+static int workers = 0;                 //!< Number of worker threads; 0: the main thread serves the page faults
+static sem_t work_sem;                  //!< Posted to wake up a worker when page faults may be posted
 
 int main(int argc, char **argv) {
-    struct sigaction sigact;
+    sigset_t sigs;
+    int i = 0;
 
-    init_pagefile(); // init page file
-    open_logger();   // open logfile
+    // scan parameter 
+    program_name = argv[0];
+    scan_params(argc, argv);
+    instance_init(instance_param);
 
     /* Create shared memory and init vmem structure */
     vmem_init();
     TEST_AND_EXIT_ERRNO(!vmem, "Error initialising vmem");
     PRINT_DEBUG((stderr, "vmem successfully created\n"));
 
-    // scan parameter 
-    vmem->adm.program_name = argv[0];
-    vmem->adm.page_rep_algo = VMEM_ALGO_FIFO;
-    scan_params(argc, argv);
-
-    /* Setup signal handler */
-    sigact.sa_handler = sighandler;
-    sigemptyset(&sigact.sa_mask);
-    sigact.sa_flags = 0;
-
-    TEST_AND_EXIT_ERRNO(sigaction(SIGUSR1, &sigact, NULL) == -1, "Error installing signal handler for USR1");
-    PRINT_DEBUG((stderr, "USR1 handler successfully installed\n"));
+    vmem->adm.program_name = program_name;
+    vmem->adm.page_rep_algo = page_rep_algo;
+    vmem->adm.replace_scope = replace_scope;
+    vmem->adm.fault_notify = fault_notify;
+    vmem->adm.spin_max = spin_max;
+
+    /* The signals will be accepted by serve_signals; vmappl may send SIGUSR1 as soon as ready is set */
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGUSR1);
+    sigaddset(&sigs, SIGUSR2);
+    sigaddset(&sigs, SIGINT);
+    TEST_AND_EXIT(pthread_sigmask(SIG_BLOCK, &sigs, NULL) != 0, (stderr, "Error blocking signals\n"));
+    if (writeback > 0) {
+        TEST_AND_EXIT_ERRNO(sem_init(&cleaner_wake, 0, 0) == -1, "sem_init of cleaner failed");
+        start_thread(cleaner);
+    }
+    if (workers > 0) {
+        TEST_AND_EXIT_ERRNO(sem_init(&work_sem, 0, 0) == -1, "sem_init of workers failed");
+        for (i = 0; i < workers; i++) {
+            start_thread(worker);
+        }
+    }
 
-    TEST_AND_EXIT_ERRNO(sigaction(SIGUSR2, &sigact, NULL) == -1, "Error installing signal handler for USR2");
-    PRINT_DEBUG((stderr,  "USR2 handler successfully installed\n"));
+    /* vmaccess waits for this flag, so no delay is required between start of mmanage and vmappl */
+    __atomic_store_n(&vmem->adm.ready, TRUE, __ATOMIC_RELEASE);
 
-    TEST_AND_EXIT_ERRNO(sigaction(SIGINT, &sigact, NULL) == -1, "Error installing signal handler for INT");
-    PRINT_DEBUG((stderr, "INT handler successfully installed\n"));
+    if (vmem->adm.fault_notify == VMEM_NOTIFY_FUTEX) {
+        start_thread(serve_signals);
+        serve_futex_faults();
+    }
 
     /* Signal processing loop */
-    while(1) {
-        signal_number = 0;
-        pause();
-        if(signal_number == SIGUSR1) {  /* Page fault */
-            PRINT_DEBUG((stderr, "Processed SIGUSR1\n"));
-            signal_number = 0;
-        }
-        else if(signal_number == SIGUSR2) {     /* PT dump */
-            PRINT_DEBUG((stderr, "Processed SIGUSR2\n"));
-            signal_number = 0;
-        }
-        else if(signal_number == SIGINT) {
-            PRINT_DEBUG((stderr, "Processed SIGINT\n"));
-        }
-    }
+    serve_signals(NULL);
 
     return 0;
 }
@@ -253,25 +284,84 @@ int main(int argc, char **argv) {
 void scan_params(int argc, char **argv) {
     int i = 0;
     unsigned char param_ok = FALSE;
+    const char *spin_str = "-spin=";
+    const char *instance_str = "-instance=";
+    const char *writeback_str = "-writeback=";
+    const char *workers_str = "-workers=";
 
     // scan all parameters (argv[0] points to program name)
-    if (argc > 2) print_usage_info_and_exit("Wrong number of parameters.\n");
-
     for (i = 1; i < argc; i++) {
         param_ok = FALSE;
         if (0 == strcasecmp("-fifo", argv[i])) {
             // page replacement strategies fifo selected 
-            vmem->adm.page_rep_algo = VMEM_ALGO_FIFO;
+            page_rep_algo = VMEM_ALGO_FIFO;
             param_ok = TRUE;
         }
         if (0 == strcasecmp("-clock", argv[i])) {
             // page replacement strategies clock selected 
-            vmem->adm.page_rep_algo = VMEM_ALGO_CLOCK;
+            page_rep_algo = VMEM_ALGO_CLOCK;
             param_ok = TRUE;
         }
         if (0 == strcasecmp("-aging", argv[i])) {
             // page replacement strategies aging selected 
-            vmem->adm.page_rep_algo = VMEM_ALGO_AGING;
+            page_rep_algo = VMEM_ALGO_AGING;
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-lru", argv[i])) {
+            // page replacement strategies lru selected 
+            page_rep_algo = VMEM_ALGO_LRU;
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-global", argv[i])) {
+            // page replacement may select any frame
+            replace_scope = VMEM_SCOPE_GLOBAL;
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-local", argv[i])) {
+            // page replacement within the share of frames of each client
+            replace_scope = VMEM_SCOPE_LOCAL;
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-futex", argv[i])) {
+            // page faults will be signaled via futex doorbells
+            fault_notify = VMEM_NOTIFY_FUTEX;
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(spin_str, argv[i], strlen(spin_str))) {
+            // max. number of polls before sleeping on a doorbell
+            if (1 == sscanf(argv[i] + strlen(spin_str), "%d", &spin_max) && spin_max >= 0) {
+                param_ok = TRUE;
+            }
+        }
+        if (0 == strcasecmp("-writeback", argv[i])) {
+            // background writeback of dirty pages with default number of frames
+            writeback = MMANAGE_WRITEBACK_DEFAULT;
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(writeback_str, argv[i], strlen(writeback_str))) {
+            // background writeback of dirty pages: number of frames examined per wake up
+            if (1 == sscanf(argv[i] + strlen(writeback_str), "%d", &writeback) && writeback >= 0) {
+                param_ok = TRUE;
+            }
+        }
+        if (0 == strncasecmp(workers_str, argv[i], strlen(workers_str))) {
+            // number of worker threads serving page faults
+            if (1 == sscanf(argv[i] + strlen(workers_str), "%d", &workers) && 
+                workers >= 0 && workers <= MMANAGE_MAXWORKERS) {
+                param_ok = TRUE;
+            }
+        }
+        if (0 == strncasecmp(instance_str, argv[i], strlen(instance_str))) {
+            // instance id of this simulation
+            instance_param = argv[i] + strlen(instance_str);
+            param_ok = TRUE;
+        }
+        if (logger_option(argv[i])) {
+            // binary logfile
+            param_ok = TRUE;
+        }
+        if (pagefile_option(argv[i])) {
+            // pagefile backend
             param_ok = TRUE;
         }
         if (!param_ok) print_usage_info_and_exit("Undefined parameter.\n"); // undefined parameter found
@@ -280,38 +370,74 @@ void scan_params(int argc, char **argv) {
 
 void print_usage_info_and_exit(char *err_str) {
     fprintf(stderr, "Wrong parameter: %s\n", err_str);
-    fprintf(stderr, "Usage : %s [OPTIONS]\n", vmem->adm.program_name);
+    fprintf(stderr, "Usage : %s [OPTIONS]\n", program_name);
     fprintf(stderr, " -fifo     : Fifo page replacement algorithm.\n");
     fprintf(stderr, " -clock    : Clock page replacement algorithm.\n");
     fprintf(stderr, " -aging    : Aging page replacement algorithm.\n");
+    fprintf(stderr, " -lru      : Exact LRU page replacement algorithm.\n");
+    fprintf(stderr, " -global   : Global page replacement: the victim may be any frame (default).\n");
+    fprintf(stderr, " -local    : Local page replacement: a client that uses its share of the frames replaces its own pages.\n");
+    fprintf(stderr, " -futex    : Signal page faults via futex doorbells instead of SIGUSR1.\n");
+    fprintf(stderr, " -spin=<n> : Poll a doorbell up to <n> times before sleeping (default 0).\n");
+    fprintf(stderr, " -writeback[=<n>] : Background writeback of dirty pages; examine <n> frames per page fault (default %d).\n", MMANAGE_WRITEBACK_DEFAULT);
+    fprintf(stderr, " -workers=<n> : Serve page faults by <n> worker threads concurrently (default 0: main thread).\n");
+    fprintf(stderr, " -instance=<id> : Instance id of this simulation (default: $%s).\n", INSTANCE_ENV);
+    pagefile_usage();
+    logger_usage();
     fprintf(stderr, " -pagesize=[8,16,32,64] : Page size.\n");
     fflush(stderr);
     exit(EXIT_FAILURE);
 }
 
-void sighandler(int signo) {
-    signal_number = signo;
-    if(signo == SIGUSR1) {
-        allocate_page();
-    } else if(signo == SIGUSR2) {
-        dump_pt();
-    } else if(signo == SIGINT) {
-        cleanup();
-        exit(EXIT_SUCCESS);
-    }  
+void *serve_signals(void *arg) {
+    sigset_t sigs;
+    int signo = 0;
+
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGUSR1);
+    sigaddset(&sigs, SIGUSR2);
+    sigaddset(&sigs, SIGINT);
+    while(1) {
+        TEST_AND_EXIT(sigwait(&sigs, &signo) != 0, (stderr, "sigwait failed\n"));
+        if(signo == SIGUSR1) {          /* Page fault */
+            PRINT_DEBUG((stderr, "Processed SIGUSR1\n"));
+            dispatch_faults();
+        } else if(signo == SIGUSR2) {   /* PT dump */
+            PRINT_DEBUG((stderr, "Processed SIGUSR2\n"));
+            dump_pt();
+        } else if(signo == SIGINT) {
+            PRINT_DEBUG((stderr, "Processed SIGINT\n"));
+            cleanup();
+            exit(EXIT_SUCCESS);
+        }
+    }
+    return NULL;
 }
 
 /* Your code goes here... */
 
+int shm_stale(int shmid) {
+	struct shmid_ds ds;
+
+	if(shmctl(shmid,IPC_STAT,&ds) == -1){
+		return errno == EINVAL || errno == EIDRM; // removed meanwhile
+	}
+	return ds.shm_nattch == 0 || (kill(ds.shm_cpid, 0) == -1 && errno == ESRCH);
+}
+
 void vmem_init(void) {
-	if(sem_unlink(NAMED_SEM) == -1){}
+	char sem_name[NAME_MAX];
+	int i = 0;
 	void* shmdata = NULL;
-	key_t key = ftok(SHMKEY,SHMPROCID);
-	 if ( key  == -1 ){
-	       perror("ftok");
-	       exit(1);
-	    }
-	int shmid = shmget(key,SHMSIZE,IPC_CREAT|SHM_R|SHM_W);
+	key_t key = instance_shm_key();
+	int shmid = shmget(key,0,0);
+	if(shmid != -1){
+		// another mmanage of this instance, or of an instance id with the same key
+		TEST_AND_EXIT(!shm_stale(shmid), (stderr, "Shared memory with key 0x%x is in use, "
+		              "is mmanage of this instance (-instance=<id>) still running?\n", (unsigned int) key));
+		shmctl(shmid,IPC_RMID,NULL); // remove stale shared memory of a previous run
+	}
+	shmid = shmget(key,SHMSIZE,IPC_CREAT|IPC_EXCL|SHM_R|SHM_W);
 	if(shmid == -1){
 		 perror("shmget");
 		   exit(1);
@@ -323,177 +449,159 @@ void vmem_init(void) {
 
 	vmem = (struct vmem_struct*)shmdata;
 	//todo captcha exeption
-	vmem->adm.size = VMEM_VIRTMEMSIZE;
+	mmcore_init(vmem);
 	vmem->adm.shm_id = shmid;
-	vmem->adm.next_alloc_idx = 0;
-	vmem->adm.req_pageno = 0;
+	vmem->adm.pf_request = DOORBELL_IDLE;
+	vmem->adm.ready = FALSE;
 	vmem->adm.mmanage_pid = getpid();
-	int i = 0;
-	for(i = 0; i< VMEM_NPAGES;i++){
-	    vmem->pt.entries[i].age = 0x80;
-		vmem->pt.entries[i].count = 0;
-		vmem->pt.entries[i].flags = 0;
-		vmem->pt.entries[i].frame = VOID_IDX;
-	}
-
-	for(i = 0; i< VMEM_NFRAMES;i++){
-		vmem->pt.framepage[i] = VOID_IDX;
-	}
-	//init semaphore todo
-	local_sem = sem_open(NAMED_SEM,O_CREAT,0777,0);
-	if(local_sem == SEM_FAILED){
-		printf("Fehler bei semaphore");
+	//init semaphores of all thread slots
+	for(i = 0; i < VMEM_MAXTHREADS; i++){
+		instance_client_name(NAMED_SEM, i, sem_name, sizeof(sem_name));
+		if(sem_unlink(sem_name) == -1){}
+		local_sem[i] = sem_open(sem_name,O_CREAT,0777,0);
+		if(local_sem[i] == SEM_FAILED){
+			printf("Fehler bei semaphore");
+		}
 	}
 
 
 }
-struct logevent event = {};
-int find_free_frame() {
-	int response = VOID_IDX;
-	int i = 0;
-	for(i = 0; i< VMEM_NFRAMES;i++){
-		if(vmem->pt.framepage[i] == VOID_IDX){
-			response = i;
-			event.replaced_page = VOID_IDX;
-			break;
-		}
-	}
-	return response;
+void serve_futex_faults(void) {
+    spin = vmem->adm.spin_max;
+    while(1) {
+        doorbell_wait(&vmem->adm.pf_request, &spin, vmem->adm.spin_max);
+        dispatch_faults();
+    }
 }
 
-void allocate_page(void) {
-	int idx = find_free_frame();
-
+void dispatch_faults(void) {
+    if (workers > 0) {
+        sem_post(&work_sem);
+    } else {
+        serve_clients();
+    }
+}
 
+void serve_clients(void) {
+    int slot;
 
-	vmem->adm.pf_count++;
-	if(idx == VOID_IDX){
-		idx = find_remove_frame();
-		TEST_AND_EXIT(idx <  0,           (stderr, "page_index out of %i  range\n",idx));
-		TEST_AND_EXIT( idx >= VMEM_NFRAMES ,         (stderr, "page_index %i out of range\n",idx));
-		vmem->pt.entries[vmem->adm.req_pageno].frame = idx;
-		fetch_page(vmem->adm.req_pageno);
-	}
-    vmem->pt.framepage[idx] = vmem->adm.req_pageno;
-
-	event.req_pageno = vmem->adm.req_pageno;
-	event.alloc_frame = idx;
-	event.pf_count =  vmem->adm.pf_count;
-	event.g_count = vmem->adm.g_count;
-	logger(event);
-
-    TEST_AND_EXIT(vmem->pt.framepage[idx] <  0,           (stderr, "page_index out of range\n"));
-    TEST_AND_EXIT(vmem->pt.framepage[idx] >= VMEM_NPAGES, (stderr, "page_index out of range\n"));
-    vmem->pt.entries[vmem->adm.req_pageno].frame = idx;
-	sem_post(local_sem);
+    /* A thread posts its page fault before it notifies mmanage, so a page fault 
+       posted after it has been checked here will be notified again. */
+    for (slot = 0; slot < VMEM_MAXTHREADS; slot++) {
+        if (__atomic_exchange_n(&vmem->threads[slot].pf_pending, FALSE, __ATOMIC_ACQUIRE)) {
+            serve_fault(slot);
+        }
+    }
 }
 
-void fetch_page(int pt_idx) {
-	int * test = &vmem->data[vmem->pt.entries[vmem->adm.req_pageno].frame * VMEM_PAGESIZE];
-	 fetch_page_from_pagefile(pt_idx,test);
-}
+void serve_fault(int slot) {
+    struct vmem_thread *t = &vmem->threads[slot];
 
-void store_page(int pt_idx) {
-	int * test = &vmem->data[vmem->adm.next_alloc_idx*VMEM_PAGESIZE];
-	store_page_to_pagefile(pt_idx, test);
+    allocate_page(t->asid, t->req_pageno, t->g_count);
+    if (vmem->adm.fault_notify == VMEM_NOTIFY_FUTEX) {
+        doorbell_ring(&t->pf_done);
+    } else {
+        sem_post(local_sem[slot]);
+    }
+    if (writeback > 0) {
+        sem_post(&cleaner_wake);
+    }
 }
 
-void update_pt(int frame) {
-}
+void *worker(void *arg) {
+    int slot;
 
-int find_remove_frame(void) {
-	int idx = -1;
-	switch(vmem->adm.page_rep_algo){
-	case VMEM_ALGO_FIFO:
-		idx = find_remove_fifo();
-		 break;
-    case VMEM_ALGO_CLOCK:
-    	idx = find_remove_clock();
-    	break;
-    case VMEM_ALGO_AGING:
-    	idx =find_remove_aging();
-    	break;
-	}
-	return idx;
+    while(1) {
+        while (sem_wait(&work_sem) == -1) {
+            TEST_AND_EXIT_ERRNO(errno != EINTR, "sem_wait of worker failed");
+        }
+        // the page fault is claimed by the exchange, so each one is served by one worker
+        for (slot = 0; slot < VMEM_MAXTHREADS; slot++) {
+            if (__atomic_exchange_n(&vmem->threads[slot].pf_pending, FALSE, __ATOMIC_ACQUIRE)) {
+                sem_post(&work_sem); // more page faults may be posted: wake up another worker
+                serve_fault(slot);
+            }
+        }
+    }
+    return NULL;
 }
-int fifo_current = -1;
-int find_remove_fifo(void) {
-	fifo_current = fifo_current == (VMEM_NFRAMES-1)? 0 : fifo_current +1;
-	vmem->adm.next_alloc_idx = fifo_current;
-    TEST_AND_EXIT(fifo_current <  0,           (stderr, "page_index out of range\n"));
-    TEST_AND_EXIT(fifo_current >= VMEM_NPAGES, (stderr, "page_index out of range\n"));
-	int element = vmem->pt.framepage[fifo_current];
-	event.replaced_page = element;
-	int d = vmem->pt.entries[element].flags & PTF_DIRTY;
-	if(d == PTF_DIRTY){
-		store_page(element);
-	}
-	// reset old one.
-	vmem->pt.entries[element].frame = VOID_IDX;
 
-	return  fifo_current;
+void *cleaner(void *arg) {
+    while(1) {
+        while (sem_wait(&cleaner_wake) == -1) {
+            TEST_AND_EXIT_ERRNO(errno != EINTR, "sem_wait of cleaner failed");
+        }
+        while (sem_trywait(&cleaner_wake) == 0) {
+            // several page faults since last wake up: clean once
+        }
+        mmcore_writeback(writeback);
+    }
+    return NULL;
 }
 
+void start_thread(void *(*start)(void *)) {
+    pthread_t thread;
+    sigset_t all;
+    sigset_t old;
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old); // the new thread inherits the mask
+    TEST_AND_EXIT(pthread_create(&thread, NULL, start, NULL) != 0, (stderr, "Error creating thread\n"));
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    pthread_detach(thread);
+}
 
-int find_remove_aging(void) {
-	vmem->adm.next_alloc_idx = VOID_IDX;
-	int age = UCHAR_MAX;
+void cleanup(void) {
+	char sem_name[NAME_MAX];
 	int i = 0;
-	for(i = 0 ; i <VMEM_NFRAMES; i++ ){
-		int page_number = vmem->pt.framepage[i];
-		if(vmem->pt.entries[page_number].age <= age){
-			age = vmem->pt.entries[page_number].age;
-			vmem->adm.next_alloc_idx = i;
-		}
-	 }
-	if(vmem->adm.next_alloc_idx == VOID_IDX){
-		vmem->adm.next_alloc_idx = 0;
-	}
 
-	int element = vmem->pt.framepage[vmem->adm.next_alloc_idx];
-	event.replaced_page = element;
-	int d = vmem->pt.entries[element].flags & PTF_DIRTY;
-	if(d == PTF_DIRTY){
-		store_page(element);
+	// the semaphores are closed by exit: workers may still answer page faults
+	for(i = 0; i < VMEM_MAXTHREADS; i++){
+		if(sem_unlink(instance_client_name(NAMED_SEM, i, sem_name, sizeof(sem_name))) == -1){}
 	}
-
-	// reset old one.
-	vmem->pt.entries[element].frame = VOID_IDX;
-	vmem->pt.entries[element].age = 0x80; // vorlesung folie.
-	return  vmem->adm.next_alloc_idx;
-
-}
-
-int find_remove_clock(void) {
-	for(;;){
-	fifo_current = fifo_current == (VMEM_NFRAMES-1)? 0 : fifo_current +1;
-	vmem->adm.next_alloc_idx = fifo_current;
-	int element = vmem->pt.framepage[fifo_current];
-	int r = vmem->pt.entries[element].flags & PTF_REF;
-	if(r == PTF_REF){
-		vmem->pt.entries[element].flags  = vmem->pt.entries[element].flags ^ PTF_REF;
-	}else{
-		event.replaced_page = element;
-		int d = vmem->pt.entries[element].flags & PTF_DIRTY;
-		if(d == PTF_DIRTY){
-			store_page(element);
-		}
-	// reset old one.
-	vmem->pt.entries[element].frame = VOID_IDX;
-	break;
+	stats_dump(stderr, &vmem->stats);
+	if(writeback > 0){
+		fprintf(stderr, "Writeback: %lu synchronous, %lu background\n", vmem->adm.wb_sync, vmem->adm.wb_background);
 	}
+	if(workers > 0){
+		fprintf(stderr, "Workers: %d, %lu coalesced page faults\n", workers, vmem->adm.pf_coalesced);
 	}
-	return  fifo_current;
-}
-
-void cleanup(void) {
-	if(sem_unlink(NAMED_SEM) == -1){}
-	if(sem_close(local_sem) == -1){}
 	shmctl(vmem->adm.shm_id,IPC_RMID,NULL);
+	mmcore_cleanup();
 
 
 }
 
 void dump_pt(void) {
+	static const char *frame_states[] = { "free", "loading", "resident", "writing" }; // index FRAME_*
+	int i = 0;
+
+	fprintf(stderr, "Page table: %d page faults, %d clients\n", vmem->adm.pf_count, vmem->adm.nclients);
+	for(i = 0; i < VMEM_MAXCLIENTS; i++){
+		struct vmem_client *c = &vmem->clients[i];
+		if(c->pid != 0 || c->nframes > 0){
+			fprintf(stderr, "ASID %4d: pid %6d, %d threads, %d frames, %lu hits, %lu page faults\n",
+			        i, c->pid, c->nthreads, c->nframes, c->hits, c->faults);
+		}
+	}
+	for(i = 0; i < VMEM_MAXTHREADS; i++){
+		struct vmem_thread *t = &vmem->threads[i];
+		if(t->pid != 0){
+			fprintf(stderr, "Thread %4d: pid %6d, ASID %4d, global count %d%s\n",
+			        i, t->pid, t->asid, t->g_count, t->pf_pending ? ", page fault pending" : "");
+		}
+	}
+	for(i = 0; i < VMEM_NFRAMES; i++){
+		struct rmap_entry *r = &vmem->pt.rmap[i];
+		if(r->page == VOID_IDX){
+			fprintf(stderr, "Frame %5d: unused\n", i);
+			continue;
+		}
+		fprintf(stderr, "Frame %5d: ASID %4d page %6d %c%c age 0x%02x %s\n", i, r->asid, r->page,
+		        (vmem->pt.entries[r->asid][r->page].flags & PTF_REF) ? 'R' : '-',
+		        (vmem->pt.entries[r->asid][r->page].flags & PTF_DIRTY) ? 'D' : '-',
+		        vmem->pt.frame_age[i], frame_states[vmem->pt.frame_state[i]]);
+	}
+	stats_dump(stderr, &vmem->stats);
 }
 // EOF
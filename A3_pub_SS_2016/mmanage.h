@@ -8,5 +8,14 @@
 #ifndef MMANAGE_H
 #define MMANAGE_H
 
+/**
+ * Default number of frames examined by the background cleaner on each wake up (-writeback)
+ */
+#define MMANAGE_WRITEBACK_DEFAULT 4
+
+/**
+ * Max. number of worker threads serving page faults (-workers)
+ */
+#define MMANAGE_MAXWORKERS 256
 
 #endif /* MMANAGE_H */
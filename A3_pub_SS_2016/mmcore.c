@@ -0,0 +1,798 @@
+/**
+ * @file mmcore.c
+ * @author Prof. Dr. Wolfgang Fohl, HAW Hamburg
+ * @date  2014
+
+ * @brief Core of the memory manager: page fault handling and page replacement.
+ *
+ * These functions have been part of mmanage.c. They have been moved to this
+ * module, so they can be linked into the application for in-process simulation
+ * as well (libmmanage.a).
+ *
+ * allocate_page may be called by several threads at the same time. The page table,
+ * the page replacement algorithms and the counters are protected by core_lock, the
+ * pagefile transfers are done without holding it. While a transfer is in progress,
+ * its frame is not RESIDENT (see FRAME_*), so it will not be selected as victim, and
+ * the in-flight table records the pages being loaded and stored: a page fault on 
+ * such a page waits until the transfer has completed instead of starting another one.
+ */
+
+#include "mmcore.h"
+#include "debug.h"
+#include "pagefile.h"
+#include "logger.h"
+#include "lru.h"
+#include "aging.h"
+#include "vmem.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
+
+#define VICTIM_ANY  0 //!< The page replacement algorithm may select any frame
+#define VICTIM_OWN  1 //!< Only frames of address space req_asid
+#define VICTIM_OVER 2 //!< Only frames of address spaces that use more than their share
+
+/*
+ * Signatures of private / static functions
+ */
+
+/**
+ *****************************************************************************************
+ *  @brief      This function does the pagefile transfers of a page fault. It will be
+ *              called without holding core_lock.
+ *
+ * If the frame stored a victim, it waits until the threads of the owner of the 
+ * victim do not access the frame anymore. A modified victim will be written and the requested 
+ * page fetched by exchange_page_with_pagefile, so both transfers may overlap.
+ *
+ *  @param      frame Frame that should store the requested page.
+ *
+ *  @param      victim Page (VMEM_GPAGE) removed from the frame; VOID_IDX: unused frame.
+ *
+ *  @param      pt_idx Index of the requested page (VMEM_GPAGE).
+ *
+ *  @param      asid Address space of the page fault.
+ *
+ *  @return     TRUE if the victim has been written to the pagefile.
+ ****************************************************************************************/
+static int transfer_page(int frame, int victim, int pt_idx, int asid);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function removes the page of the victim frame: the page table entry
+ *              and the translation caches of the clients will be invalidated and the 
+ *              page will be entered as possible store into the in-flight table.
+ *              transfer_page stores the page if it has been modified.
+ *
+ *  @param      frame The victim frame.
+ * 
+ *  @return     void 
+ ****************************************************************************************/
+static void remove_page(int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function undoes remove_page: the page of the frame will be valid
+ *              again without a transfer. It is used by mmcore_time_victims only.
+ *
+ *  @param      frame The victim frame.
+ * 
+ *  @return     void 
+ ****************************************************************************************/
+static void restore_page(int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function searchs a page in the in-flight table.
+ *
+ *  @param      pt_idx Index of the page (VMEM_GPAGE).
+ *
+ *  @return     The frame the page is being loaded into or stored from; 
+ *              VOID_IDX if no transfer of the page is in progress.
+ ****************************************************************************************/
+static int inflight_find(int pt_idx);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function waits until all threads of a client have finished their
+ *              current access to a frame. It must be called after the frame has been 
+ *              invalidated.
+ *
+ *  A thread marks its accesses by vmem_thread.inside without a memory barrier
+ *  of its own. membarrier executes one on all CPUs running a client, so either the
+ *  thread sees the invalidated frame or this function sees the thread inside.
+ *  membarrier reaches only registered clients (vmem_init), in-process threads
+ *  as well. If it is not available (vmem_adm_struct.membarrier) or a client 
+ *  could not register, the client uses barriers itself.
+ *
+ *  @param      asid Address space of the client.
+ * 
+ *  @return     void 
+ ****************************************************************************************/
+static void quiesce(int asid);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function determines the frames the page replacement algorithm 
+ *              may select for a page fault of req_asid (victims and share).
+ *
+ *  Frames pinned by a compound access of vmaccess (vmem_swap) will not be selected
+ *  unless all frames that may be replaced are pinned.
+ *
+ *  @return     FALSE if no frame may be replaced because all of them are being 
+ *              loaded or stored.
+ ****************************************************************************************/
+static int select_victims(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function checks whether a frame may be selected as victim.
+ *
+ *  @param      frame A frame in use.
+ *
+ *  @return     TRUE if the frame is resident, not pinned and may be replaced.
+ ****************************************************************************************/
+static int may_replace(int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function finds an unused frame.
+ *
+ *  The bitmap vmem->pt.freeframes marks unused frames. find_free_frame searchs
+ *  the first non zero word and returns its lowest set bit, i.e. the free frame
+ *  with the smallest frame number.
+ *
+ *  @return     idx of the unused frame with the smallest idx. 
+ *              If all frames are in use, VOID_IDX will be returned.
+ ****************************************************************************************/
+static int find_free_frame();
+
+/**
+ *****************************************************************************************
+ *  @brief      This function update the page table for the requested page.
+ *              It will be stored in frame.
+ *
+ *  @param      frame The frame that stores the now allocated page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void update_pt(int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm aging.
+ *
+ *  @return     idx of the page that should be replaced.
+ ****************************************************************************************/
+static int find_remove_aging(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm fifo.
+ *
+ *  @return     idx of the page that should be replaced.
+ ****************************************************************************************/
+static int find_remove_fifo(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm clock.
+ *
+ *  @return     idx of the page that should be replaced.
+ ****************************************************************************************/
+static int find_remove_clock(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm LRU.
+ *              The victim is the head of the LRU list maintained by vmaccess.
+ *
+ *  @return     idx of the page that should be replaced.
+ ****************************************************************************************/
+static int find_remove_lru(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function selects and starts a page replacement algorithm.
+ *
+ *  It is just a wrapper for the page replacement algorithms.
+ *
+ *  @return     The idx of the page that should be replaced.
+ ****************************************************************************************/
+static int find_remove_frame(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function collects the frames that will probably be selected as the
+ *              next victims by the current page replacement algorithm.
+ *
+ *  @param      frames Array that receives up to n frame numbers.
+ *
+ *  @param      n Max. number of frames.
+ *
+ *  @return     Number of frames stored in frames.
+ ****************************************************************************************/
+static int next_victims(int *frames, int n);
+
+/*
+ * variables
+ */
+
+/**
+ * Pagefile transfers of a frame that are in progress without holding core_lock
+ */
+struct inflight {
+    int load;                           //!< Page (VMEM_GPAGE) being fetched into the frame; VOID_IDX: none
+    int store;                          //!< Page (VMEM_GPAGE) that may be written from the frame; VOID_IDX: none
+};
+
+static struct vmem_struct *vmem = NULL; //!< Reference to virtual memory
+static int fifo_current = -1;           //!< Last frame selected by FIFO and CLOCK algorithm
+static pthread_mutex_t core_lock;      //!< Protects page table, page replacement and in-flight table; error checking, see mmcore_cleanup
+static pthread_cond_t inflight_done = PTHREAD_COND_INITIALIZER; //!< Broadcast when transfers have completed
+static struct inflight inflight[VMEM_NFRAMES]; //!< In-flight table, index: frame
+static int ninflight = 0;               //!< Number of frames with transfers in progress
+static unsigned char wb_busy[VMEM_NFRAMES]; //!< TRUE while mmcore_writeback writes the page of a frame
+static int req_asid = 0;                //!< Address space of the page fault handled by allocate_page
+static int victims = VICTIM_ANY;        //!< Frames that may be replaced, see VICTIM_*
+static int share = VMEM_NFRAMES;        //!< Local replacement: number of frames of each client
+static unsigned char pinned[VMEM_NFRAMES]; //!< Frames pinned by vmaccess when select_victims ran
+
+void mmcore_init(struct vmem_struct *vm) {
+    pthread_mutexattr_t attr;
+    int membarrier = 0;
+    int i = 0;
+
+    vmem = vm;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+    TEST_AND_EXIT(pthread_mutex_init(&core_lock, &attr) != 0, (stderr, "Error initialising core lock\n"));
+    pthread_mutexattr_destroy(&attr);
+    init_pagefile(); // init page file
+    open_logger();   // open logfile
+
+    vmem->adm.size = VMEM_VIRTMEMSIZE;
+    vmem->adm.next_alloc_idx = 0;
+    vmem->adm.pf_count = 0;
+    vmem->adm.nclients = 0;
+    vmem->adm.wb_sync = 0;
+    vmem->adm.wb_background = 0;
+    vmem->adm.pf_coalesced = 0;
+    membarrier = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0, 0);
+    vmem->adm.membarrier = membarrier != -1 && (membarrier & MEMBARRIER_CMD_GLOBAL_EXPEDITED) != 0;
+    stats_init(&vmem->stats);
+    memset(&vmem->counters, 0, sizeof(vmem->counters));
+    memset(vmem->clients, 0, sizeof(vmem->clients));
+    memset(vmem->threads, 0, sizeof(vmem->threads));
+    for(i = 0; i< VMEM_NGPAGES;i++){
+        struct pt_entry *e = &vmem->pt.entries[i / VMEM_NPAGES][i % VMEM_NPAGES];
+        e->age = 0x80;
+        e->count = 0;
+        e->flags = 0;
+        e->frame = VOID_IDX;
+    }
+    for(i = 0; i< VMEM_NFRAMES;i++){
+        vmem->pt.rmap[i].asid = VOID_IDX;
+        vmem->pt.rmap[i].page = VOID_IDX;
+        vmem->pt.framegen[i] = 0;
+        vmem->pt.frame_loaded[i] = 0;
+        vmem->pt.frame_age[i] = 0;
+        vmem->pt.frame_ref[i] = 0;
+        vmem->pt.frame_state[i] = FRAME_FREE;
+        vmem->pt.frame_pins[i] = 0;
+        inflight[i].load = VOID_IDX;
+        inflight[i].store = VOID_IDX;
+        wb_busy[i] = FALSE;
+    }
+    ninflight = 0;
+    for(i = 0; i < VMEM_NFRAMEWORDS; i++){
+        vmem->pt.freeframes[i] = 0;
+    }
+    for(i = 0; i < VMEM_NFRAMES; i++){
+        vmem->pt.freeframes[i / 64] |= 1ULL << (i % 64);
+    }
+    lru_init(&vmem->pt);
+    vmem->pt.aging_lock = 0;
+}
+
+void mmcore_cleanup(void) {
+    /* Wait for running transfers. The lock will be kept, so the pagefile will not be
+       used after it has been closed. The calling thread holds the lock already if it
+       exits from allocate_page on an error (EDEADLK): don't wait then. */
+    if(pthread_mutex_lock(&core_lock) == 0){
+        while(ninflight > 0){
+            pthread_cond_wait(&inflight_done, &core_lock);
+        }
+    }
+    close_logger();
+    cleanup_pagefile();
+}
+
+int find_free_frame() {
+	int response = VOID_IDX;
+	int i = 0;
+	for(i = 0; i < VMEM_NFRAMEWORDS; i++){
+		if(vmem->pt.freeframes[i] != 0){
+			response = i * 64 + __builtin_ctzll(vmem->pt.freeframes[i]);
+			vmem->pt.freeframes[i] &= vmem->pt.freeframes[i] - 1; // frame is in use now
+			vmem->pt.frame_state[response] = FRAME_LOADING;
+			COUNTER_ADD(vmem->counters.resident, 1);
+			break;
+		}
+	}
+	return response;
+}
+
+void allocate_page(int asid, int page, int g_count) {
+	unsigned long long start = stats_now();
+	unsigned long long t = 0;
+	struct pt_entry *e = &vmem->pt.entries[asid][page];
+	struct logevent event = {};
+	int pt_idx = VMEM_GPAGE(asid, page);
+	int idx = VOID_IDX;
+	int victim = VOID_IDX;
+	int stored = FALSE;
+
+	TEST_AND_EXIT(asid < 0 || asid >= VMEM_MAXCLIENTS, (stderr, "asid %i out of range\n", asid));
+	TEST_AND_EXIT(page < 0 || page >= VMEM_NPAGES,     (stderr, "page_index %i out of range\n", page));
+	pthread_mutex_lock(&core_lock);
+	while(1){
+		if(__atomic_load_n(&e->frame, __ATOMIC_RELAXED) != VOID_IDX){
+			// the page has been loaded for another page fault: no transfer
+			vmem->adm.pf_coalesced++;
+			pthread_mutex_unlock(&core_lock);
+			return;
+		}
+		if(inflight_find(pt_idx) == VOID_IDX){
+			req_asid = asid;
+			idx = find_free_frame();
+			if(idx != VOID_IDX){
+				break;
+			}
+			if(select_victims()){
+				t = stats_now();
+				idx = find_remove_frame();
+				hist_record(&vmem->stats.victim, stats_now() - t);
+				TEST_AND_EXIT(idx <  0,           (stderr, "page_index out of %i  range\n",idx));
+				TEST_AND_EXIT( idx >= VMEM_NFRAMES ,         (stderr, "page_index %i out of range\n",idx));
+				victim = inflight[idx].store;
+				break;
+			}
+		}
+		// the page is being loaded or stored, or all frames are being loaded
+		pthread_cond_wait(&inflight_done, &core_lock);
+	}
+	vmem->adm.pf_count++;
+	inflight[idx].load = pt_idx;
+	ninflight++;
+    vmem->pt.rmap[idx].asid = asid;
+    vmem->pt.rmap[idx].page = page;
+    vmem->pt.frame_loaded[idx] = vmem->adm.pf_count;
+    // clients do aging steps concurrently
+    aging_lock(&vmem->pt.aging_lock);
+    vmem->pt.frame_age[idx] = e->age;
+    __atomic_store_n(&vmem->pt.frame_ref[idx], (e->flags & PTF_REF) ? AGING_REF : 0, __ATOMIC_RELAXED);
+    aging_unlock(&vmem->pt.aging_lock);
+    vmem->clients[asid].nframes++;
+
+	event.replaced_page = victim;
+	event.req_pageno = pt_idx;
+	event.alloc_frame = idx;
+	event.pf_count =  vmem->adm.pf_count;
+	event.g_count = g_count;
+	log_event(event);
+	pthread_mutex_unlock(&core_lock);
+
+	t = stats_now();
+	stored = transfer_page(idx, victim, pt_idx, asid);
+	t = stats_now() - t;
+
+	pthread_mutex_lock(&core_lock);
+	COUNTER_ADD(vmem->counters.pages_read, 1);
+	COUNTER_ADD(vmem->counters.bytes_read, VMEM_PAGESIZE * sizeof(int));
+	if(victim != VOID_IDX){
+		COUNTER_ADD(vmem->counters.evictions, 1);
+		if(stored){
+			vmem->adm.wb_sync++;
+			COUNTER_ADD(vmem->counters.evict_dirty, 1);
+			COUNTER_ADD(vmem->counters.pages_written, 1);
+			COUNTER_ADD(vmem->counters.bytes_written, VMEM_PAGESIZE * sizeof(int));
+		} else {
+			COUNTER_ADD(vmem->counters.evict_clean, 1);
+		}
+	}
+	hist_record(stored ? &vmem->stats.exchange : &vmem->stats.fetch, t);
+	inflight[idx].load = VOID_IDX;
+	inflight[idx].store = VOID_IDX;
+	ninflight--;
+	vmem->pt.frame_state[idx] = FRAME_RESIDENT;
+    if(vmem->adm.page_rep_algo == VMEM_ALGO_LRU){
+        // the new page is the most recently used one; with many clients a frame must
+        // not wait for the first access of its client to become a victim again
+        lru_lock(&vmem->pt);
+        lru_touch(&vmem->pt, idx);
+        lru_unlock(&vmem->pt);
+    }
+
+    // the page is valid when it has been loaded completely
+    __atomic_store_n(&e->frame, idx, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&inflight_done);
+	hist_record(&vmem->stats.alloc, stats_now() - start);
+	pthread_mutex_unlock(&core_lock);
+}
+
+unsigned long long mmcore_time_victims(int n) {
+	unsigned long long start = 0;
+	unsigned long long t = 0;
+	int i = 0;
+
+	pthread_mutex_lock(&core_lock);
+	for(i = 0; i < VMEM_NFRAMEWORDS; i++){
+		if(vmem->pt.freeframes[i] != 0){
+			pthread_mutex_unlock(&core_lock);
+			return 0; // a page fault would not replace a page
+		}
+	}
+	req_asid = vmem->pt.rmap[0].asid;
+	if(ninflight == 0 && select_victims()){
+		start = stats_now();
+		for(i = 0; i < n; i++){
+			restore_page(find_remove_frame());
+		}
+		t = stats_now() - start;
+	}
+	pthread_mutex_unlock(&core_lock);
+	return t;
+}
+
+int mmcore_writeback(int n) {
+	int frames[VMEM_NFRAMES];
+	int pages[VMEM_NFRAMES];
+	int written = 0;
+	int i = 0;
+
+	pthread_mutex_lock(&core_lock);
+	n = next_victims(frames, (n < VMEM_NFRAMES) ? n : VMEM_NFRAMES);
+	for(i = 0; i < n; i++){
+		struct rmap_entry *r = &vmem->pt.rmap[frames[i]];
+		if(vmem->pt.frame_state[frames[i]] != FRAME_RESIDENT){
+			continue;
+		}
+		if(__atomic_fetch_and(&vmem->pt.entries[r->asid][r->page].flags, ~PTF_DIRTY, __ATOMIC_ACQ_REL) & PTF_DIRTY){
+			// the page stays valid and may be replaced; transfer_page waits for the write
+			wb_busy[frames[i]] = TRUE;
+			pages[written] = VMEM_GPAGE(r->asid, r->page);
+			frames[written++] = frames[i];
+		}
+	}
+	ninflight += written;
+	pthread_mutex_unlock(&core_lock);
+
+	for(i = 0; i < written; i++){
+		store_page_to_pagefile(pages[i], &vmem->data[frames[i] * VMEM_PAGESIZE]);
+	}
+
+	pthread_mutex_lock(&core_lock);
+	for(i = 0; i < written; i++){
+		wb_busy[frames[i]] = FALSE;
+	}
+	ninflight -= written;
+	vmem->adm.wb_background += written;
+	COUNTER_ADD(vmem->counters.pages_written, written);
+	COUNTER_ADD(vmem->counters.bytes_written, written * VMEM_PAGESIZE * sizeof(int));
+	__atomic_fetch_sub(&vmem->counters.dirty, written, __ATOMIC_RELAXED);
+	if(written > 0){
+		pthread_cond_broadcast(&inflight_done);
+	}
+	pthread_mutex_unlock(&core_lock);
+	return written;
+}
+
+int next_victims(int *frames, int n) {
+	unsigned char age[VMEM_NFRAMES];
+	int frame = fifo_current;
+	int i = 0;
+
+	for(i = 0; i < VMEM_NFRAMEWORDS; i++){
+		if(vmem->pt.freeframes[i] != 0){
+			return 0; // the next page faults will not replace a page
+		}
+	}
+	switch(vmem->adm.page_rep_algo){
+	case VMEM_ALGO_FIFO:
+	case VMEM_ALGO_CLOCK:
+		for(i = 0; i < n; i++){
+			frame = (frame == VMEM_NFRAMES - 1) ? 0 : frame + 1;
+			frames[i] = frame;
+		}
+		break;
+	case VMEM_ALGO_AGING:
+		aging_lock(&vmem->pt.aging_lock);
+		memcpy(age, vmem->pt.frame_age, sizeof(age));
+		aging_unlock(&vmem->pt.aging_lock);
+		for(i = 0; i < n; i++){
+			frames[i] = aging_find_min(age, VMEM_NFRAMES);
+			age[frames[i]] = UCHAR_MAX; // don't select it again
+		}
+		break;
+	case VMEM_ALGO_LRU:
+		// vmaccess relinks the list concurrently: the result is just a hint
+		frame = vmem->pt.lru_head;
+		for(i = 0; i < n && frame >= 0 && frame < VMEM_NFRAMES; i++){
+			frames[i] = frame;
+			frame = vmem->pt.lru_next[frame];
+		}
+		n = i;
+		break;
+	default:
+		n = 0;
+	}
+	return n;
+}
+
+int transfer_page(int frame, int victim, int pt_idx, int asid) {
+	int *data = &vmem->data[frame * VMEM_PAGESIZE];
+
+	if(victim != VOID_IDX){
+		struct pt_entry *v = &vmem->pt.entries[victim / VMEM_NPAGES][victim % VMEM_NPAGES];
+		/* The thread of the page fault does not access a frame. It may be the only one
+		   of its client; the fence orders the load after the invalidation of the victim. */
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if(victim / VMEM_NPAGES != asid || __atomic_load_n(&vmem->clients[asid].nthreads, __ATOMIC_RELAXED) > 1){
+			quiesce(victim / VMEM_NPAGES);
+		}
+		if(__atomic_load_n(&wb_busy[frame], __ATOMIC_ACQUIRE)){
+			// mmcore_writeback is writing the victim: the frame must not be overwritten yet
+			pthread_mutex_lock(&core_lock);
+			while(wb_busy[frame]){
+				pthread_cond_wait(&inflight_done, &core_lock);
+			}
+			pthread_mutex_unlock(&core_lock);
+		}
+		// the page is clean when it will be loaded again
+		if(__atomic_fetch_and(&v->flags, ~PTF_DIRTY, __ATOMIC_ACQ_REL) & PTF_DIRTY){
+			__atomic_fetch_sub(&vmem->counters.dirty, 1, __ATOMIC_RELAXED);
+			exchange_page_with_pagefile(victim, data, pt_idx, data);
+			return TRUE;
+		}
+	}
+	__atomic_store_n(&vmem->pt.frame_state[frame], FRAME_LOADING, __ATOMIC_RELAXED);
+	fetch_page_from_pagefile(pt_idx, data);
+	return FALSE;
+}
+
+int inflight_find(int pt_idx) {
+	int i = 0;
+
+	for(i = 0; ninflight > 0 && i < VMEM_NFRAMES; i++){
+		if(inflight[i].load == pt_idx || inflight[i].store == pt_idx){
+			return i;
+		}
+	}
+	return VOID_IDX;
+}
+
+void update_pt(int frame) {
+}
+
+int find_remove_frame(void) {
+	int idx = -1;
+	switch(vmem->adm.page_rep_algo){
+	case VMEM_ALGO_FIFO:
+		idx = find_remove_fifo();
+		 break;
+    case VMEM_ALGO_CLOCK:
+    	idx = find_remove_clock();
+    	break;
+    case VMEM_ALGO_AGING:
+    	idx =find_remove_aging();
+    	break;
+    case VMEM_ALGO_LRU:
+    	idx = find_remove_lru();
+    	break;
+	}
+	return idx;
+}
+int find_remove_fifo(void) {
+	int i = 0;
+
+	if(victims == VICTIM_ANY){
+		do {
+			// the hand skips frames that are being loaded or stored
+			fifo_current = fifo_current == (VMEM_NFRAMES-1)? 0 : fifo_current +1;
+		} while(!may_replace(fifo_current));
+		vmem->adm.next_alloc_idx = fifo_current;
+	} else {
+		// the hand does not follow the order of loading within a subset of the frames
+		vmem->adm.next_alloc_idx = VOID_IDX;
+		for(i = 0; i < VMEM_NFRAMES; i++){
+			if(may_replace(i) && (vmem->adm.next_alloc_idx == VOID_IDX || 
+			   vmem->pt.frame_loaded[i] < vmem->pt.frame_loaded[vmem->adm.next_alloc_idx])){
+				vmem->adm.next_alloc_idx = i;
+			}
+		}
+	}
+    TEST_AND_EXIT(vmem->adm.next_alloc_idx <  0,           (stderr, "page_index out of range\n"));
+    TEST_AND_EXIT(vmem->adm.next_alloc_idx >= VMEM_NFRAMES, (stderr, "page_index out of range\n"));
+	remove_page(vmem->adm.next_alloc_idx);
+	return  vmem->adm.next_alloc_idx;
+}
+
+
+int find_remove_aging(void) {
+	int i = 0;
+
+	vmem->adm.next_alloc_idx = VOID_IDX;
+	aging_lock(&vmem->pt.aging_lock); // no aging step while the ages are compared
+	if(victims == VICTIM_ANY){
+		vmem->adm.next_alloc_idx = aging_find_min(vmem->pt.frame_age, VMEM_NFRAMES);
+	}
+	if(vmem->adm.next_alloc_idx == VOID_IDX || !may_replace(vmem->adm.next_alloc_idx)){
+		// local replacement, or the frame with the smallest age is being loaded or stored
+		vmem->adm.next_alloc_idx = VOID_IDX;
+		for(i = 0; i < VMEM_NFRAMES; i++){
+			// last frame with the smallest age like aging_find_min
+			if(may_replace(i) && (vmem->adm.next_alloc_idx == VOID_IDX || 
+			   vmem->pt.frame_age[i] <= vmem->pt.frame_age[vmem->adm.next_alloc_idx])){
+				vmem->adm.next_alloc_idx = i;
+			}
+		}
+	}
+	aging_unlock(&vmem->pt.aging_lock);
+
+	struct rmap_entry *r = &vmem->pt.rmap[vmem->adm.next_alloc_idx];
+	struct pt_entry *element = &vmem->pt.entries[r->asid][r->page];
+	// the reference bit stays with the page, it will be taken over when the page is loaded again
+	if(__atomic_load_n(&vmem->pt.frame_ref[vmem->adm.next_alloc_idx], __ATOMIC_RELAXED) != 0){
+		__atomic_fetch_or(&element->flags, PTF_REF, __ATOMIC_RELAXED);
+	} else {
+		__atomic_fetch_and(&element->flags, ~PTF_REF, __ATOMIC_RELAXED);
+	}
+	remove_page(vmem->adm.next_alloc_idx);
+	element->age = 0x80; // vorlesung folie.
+	return  vmem->adm.next_alloc_idx;
+
+}
+
+int find_remove_clock(void) {
+	for(;;){
+	fifo_current = fifo_current == (VMEM_NFRAMES-1)? 0 : fifo_current +1;
+	vmem->adm.next_alloc_idx = fifo_current;
+	if(!may_replace(fifo_current)){
+		continue; // local replacement: the hand skips the frames of other clients
+	}
+	struct rmap_entry *r = &vmem->pt.rmap[fifo_current];
+	struct pt_entry *element = &vmem->pt.entries[r->asid][r->page];
+	int ref = __atomic_load_n(&element->flags, __ATOMIC_RELAXED) & PTF_REF;
+	if(ref == PTF_REF){
+		__atomic_fetch_and(&element->flags, ~PTF_REF, __ATOMIC_RELAXED);
+	}else{
+		remove_page(fifo_current);
+		break;
+	}
+	}
+	return  fifo_current;
+}
+
+int find_remove_lru(void) {
+	lru_lock(&vmem->pt);
+	int frame = vmem->pt.lru_head;
+	while(frame != VOID_IDX && !may_replace(frame)){
+		frame = vmem->pt.lru_next[frame];
+	}
+	TEST_AND_EXIT(frame == VOID_IDX, (stderr, "LRU list empty\n"));
+	// allocate_page links the frame again
+	lru_remove(&vmem->pt, frame);
+	lru_unlock(&vmem->pt); // the owner of the page may wait for the lock inside an access
+	vmem->adm.next_alloc_idx = frame;
+	remove_page(frame);
+	return frame;
+}
+
+void remove_page(int frame) {
+	struct rmap_entry *r = &vmem->pt.rmap[frame];
+	struct pt_entry *e = &vmem->pt.entries[r->asid][r->page];
+
+	// reset old one; the order matters for vmaccess (see lookup_frame)
+	__atomic_store_n(&e->frame, VOID_IDX, __ATOMIC_RELEASE);
+	__atomic_store_n(&vmem->pt.framegen[frame], vmem->pt.framegen[frame] + 1, __ATOMIC_RELEASE); // invalidates translation caches
+	vmem->pt.frame_state[frame] = FRAME_WRITING;
+	inflight[frame].store = VMEM_GPAGE(r->asid, r->page);
+	vmem->clients[r->asid].nframes--;
+}
+
+void restore_page(int frame) {
+	struct rmap_entry *r = &vmem->pt.rmap[frame];
+	struct pt_entry *e = &vmem->pt.entries[r->asid][r->page];
+
+	inflight[frame].store = VOID_IDX;
+	vmem->pt.frame_state[frame] = FRAME_RESIDENT;
+	vmem->clients[r->asid].nframes++;
+	if(vmem->adm.page_rep_algo == VMEM_ALGO_LRU){
+		lru_lock(&vmem->pt);
+		lru_touch(&vmem->pt, frame);
+		lru_unlock(&vmem->pt);
+	}
+	__atomic_store_n(&e->frame, frame, __ATOMIC_RELEASE);
+}
+
+void quiesce(int asid) {
+	int polls = 0;
+	int i = 0;
+
+	if(__atomic_load_n(&vmem->clients[asid].pid, __ATOMIC_RELAXED) == 0){
+		return; // no client uses this address space
+	}
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(vmem->adm.membarrier){
+		TEST_AND_EXIT_ERRNO(syscall(SYS_membarrier, MEMBARRIER_CMD_GLOBAL_EXPEDITED, 0, 0) == -1, "membarrier");
+	}
+	for(i = 0; i < VMEM_MAXTHREADS; i++){
+		struct vmem_thread *t = &vmem->threads[i];
+		pid_t pid = __atomic_load_n(&t->pid, __ATOMIC_ACQUIRE);
+		if(pid == 0 || __atomic_load_n(&t->asid, __ATOMIC_RELAXED) != asid){
+			continue;
+		}
+		while(__atomic_load_n(&t->inside, __ATOMIC_ACQUIRE)){
+			if(++polls % 1024 == 0 && kill(pid, 0) == -1 && errno == ESRCH){
+				break; // the client terminated inside an access
+			}
+			sched_yield();
+		}
+	}
+}
+
+int select_victims(void) {
+	int nclients = __atomic_load_n(&vmem->adm.nclients, __ATOMIC_RELAXED);
+	int i = 0;
+
+	victims = VICTIM_ANY;
+	memset(pinned, 0, sizeof(pinned));
+	if(vmem->adm.replace_scope == VMEM_SCOPE_LOCAL){
+		share = VMEM_NFRAMES / ((nclients > 1) ? nclients : 1);
+		share = (share > 0) ? share : 1;
+		victims = (vmem->clients[req_asid].nframes >= share) ? VICTIM_OWN : VICTIM_OVER;
+		for(i = 0; i < VMEM_NFRAMES && !may_replace(i); i++){
+		}
+		if(i == VMEM_NFRAMES){
+			// more clients than frames: nobody is above its share, or the own frames are being loaded
+			victims = VICTIM_ANY;
+		}
+	}
+	// a snapshot, the pins change without core_lock
+	for(i = 0; i < VMEM_NFRAMES; i++){
+		pinned[i] = __atomic_load_n(&vmem->pt.frame_pins[i], __ATOMIC_RELAXED) != 0;
+	}
+	for(i = 0; i < VMEM_NFRAMES && !may_replace(i); i++){
+	}
+	if(i == VMEM_NFRAMES){
+		// all frames that may be replaced are pinned: vmaccess validates its translations
+		memset(pinned, 0, sizeof(pinned));
+		for(i = 0; i < VMEM_NFRAMES && !may_replace(i); i++){
+		}
+	}
+	return i < VMEM_NFRAMES;
+}
+
+int may_replace(int frame) {
+	int asid = vmem->pt.rmap[frame].asid;
+
+	if(vmem->pt.frame_state[frame] != FRAME_RESIDENT || pinned[frame]){
+		return FALSE;
+	}
+	switch(victims){
+	case VICTIM_OWN:
+		return asid == req_asid;
+	case VICTIM_OVER:
+		// pages of terminated clients count as above the share
+		return vmem->clients[asid].nframes > share || __atomic_load_n(&vmem->clients[asid].pid, __ATOMIC_RELAXED) == 0;
+	default:
+		return TRUE;
+	}
+}
+
+// EOF
@@ -0,0 +1,112 @@
+/**
+ * @file mmcore.h
+ * @brief Header file of the memory manager core.
+ *
+ * The core contains page fault handling and the page replacement algorithms
+ * of mmanage. It works on a struct vmem_struct that may be located in shared 
+ * memory (mmanage process) or in the application process itself (in-process 
+ * simulation, see vmem_init_inproc in vmaccess.h). Together with the pagefile
+ * and the logger module it will be build as library libmmanage.a.
+ */
+
+#ifndef MMCORE_H
+#define MMCORE_H
+
+#include "vmem.h"
+
+/**
+ *****************************************************************************************
+ *  @brief      This function initializes the core.
+ *
+ *  It creates the pagefile, opens the logfile and initializes the page table 
+ *  and the administration data of vmem that are used by the core.
+ *
+ *  @param      vm The virtual memory the core should work on.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void mmcore_init(struct vmem_struct *vm);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function allocates a new page into memory. If all frames are in 
+ *              use the corresponding page replacement algorithm will be called.
+ *
+ *  allocate_page updates the page table of address space asid and the reverse map 
+ *  and logs the page fault as well. The page will be logged as VMEM_GPAGE(asid, page).
+ *  allocate_page does all actions that must be done when a page fault has been
+ *  signaled.
+ *
+ *  With global replacement (vmem->adm.replace_scope) the victim may be any frame.
+ *  With local replacement a client that uses at least its share of the frames 
+ *  (VMEM_NFRAMES / number of clients) replaces one of its own pages, a client below 
+ *  its share replaces a page of a client above its share.
+ *  allocate_page waits until the threads of the owner of the victim do not access
+ *  the frame anymore (see vmaccess.c); the thread of the page fault does not wait for
+ *  itself.
+ *
+ *  allocate_page may be called by several threads at the same time; the pagefile
+ *  transfers of different page faults run concurrently. A page fault on a page that 
+ *  is being loaded for another page fault waits for this transfer and will not be 
+ *  logged (vmem->adm.pf_coalesced), so each page will be fetched once.
+ *
+ *  @param      asid Address space of the page fault.
+ *
+ *  @param      page The requested page.
+ *
+ *  @param      g_count Access counter of the thread of the page fault; it will be logged.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void allocate_page(int asid, int page, int g_count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function times n selections of a victim by the current page 
+ *              replacement algorithm (find_remove_*) on the full frame table.
+ *
+ *  Each victim gets its page back at once, without a pagefile transfer, so the
+ *  frame table stays full and the algorithm keeps its state (hand, ages, list) 
+ *  as after a page fault. The page of the victim will be invalidated and made 
+ *  valid again, so no client must access the virtual memory meanwhile. 
+ *  It is meant for benchmarks (vmbench).
+ *
+ *  @param      n Number of selections.
+ *
+ *  @return     Time of all selections in ns; 0 if there is an unused frame or 
+ *              a transfer is running.
+ ****************************************************************************************/
+unsigned long long mmcore_time_victims(int n);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes back dirty pages that will probably be replaced soon.
+ *
+ *  It examines up to n frames in the order the current page replacement algorithm
+ *  would select its next victims: the frames ahead of the hand for FIFO and CLOCK, 
+ *  the frames with the smallest age for aging and the head of the list for LRU.
+ *  Nothing will be done as long as there are unused frames.
+ *  PTF_DIRTY of a page will be cleared before the page will be written. vmaccess 
+ *  sets PTF_DIRTY atomically after each store, so a page that has been modified 
+ *  while it has been written stays dirty.
+ *
+ *  mmcore_writeback may be called by a thread other than the ones that handle page 
+ *  faults. A frame being written may be selected as victim, but it will not be 
+ *  overwritten until the write has completed.
+ *
+ *  @param      n Max. number of frames to be examined.
+ *
+ *  @return     Number of pages written.
+ ****************************************************************************************/
+int mmcore_writeback(int n);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function closes pagefile and logfile of the core when the
+ *              running transfers are complete. The core must not be used afterwards.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void mmcore_cleanup(void);
+
+#endif /* MMCORE_H */
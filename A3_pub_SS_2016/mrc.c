@@ -0,0 +1,332 @@
+/**
+ * @file mrc.c
+ * @brief This module computes miss ratio curves of an access stream.
+ *        See mrc.h for the algorithms and the result format.
+ */
+
+#include <limits.h>
+#include "vmem.h"
+#include "mrc.h"
+#include "aging.h"
+#include "shards.h"
+#include "debug.h"
+#include "mytypes.h"
+
+#define MRC_NSIZES   4                            //!< Number of page sizes
+#define MRC_MAXPAGES (VMEM_VIRTMEMSIZE / 8)       //!< Number of pages of the smallest page size
+#define MRC_NALGOS   3                            //!< Simulated algorithms: FIFO, AGING, CLOCK (VMEM_ALGO_*)
+
+static const int mrc_pagesizes[MRC_NSIZES] = { 8, 16, 32, 64 };
+
+/**
+ * Model of physical memory with a fixed number of frames managed by FIFO,
+ * CLOCK or AGING like mmcore.c
+ */
+struct mrc_sim {
+    int nframes;                          //!< number of frames
+    int used;                             //!< frames in use; frames are allocated in ascending order
+    int hand;                             //!< last frame selected by FIFO and CLOCK
+    unsigned long faults;                 //!< number of page faults
+    int frame_of[MRC_MAXPAGES];           //!< frame of each page; VOID_IDX: not resident
+    int page_of[MRC_MAXPAGES];            //!< page of each frame in use
+    unsigned char pageref[MRC_MAXPAGES];  //!< CLOCK: PTF_REF of each page
+    unsigned char age[MRC_MAXPAGES];      //!< AGING: age of each frame
+    unsigned char ref[MRC_MAXPAGES];      //!< AGING: reference bit of each frame
+};
+
+/**
+ * State of all curves of one page size
+ */
+struct mrc_size {
+    int pagesize;                         //!< page size in ints
+    int npages;                           //!< number of pages of the virtual memory
+    unsigned int now;                     //!< time of the last access (index of tree)
+    unsigned int last[MRC_MAXPAGES];      //!< time of the last access of each page; 0: never accessed
+    int tree[MRC_TIMES + 1];              //!< Fenwick tree: 1 at the time of the last access of each page
+    unsigned long dist[MRC_MAXPAGES + 1]; //!< number of accesses per stack distance
+    unsigned long cold;                   //!< number of first accesses to a page
+    struct mrc_sim sim[MRC_NALGOS][MRC_MAXPAGES]; //!< models of VMEM_ALGO_* with 1 .. npages frames
+};
+
+/*
+ * static variables
+ */
+static struct mrc_size *sizes = NULL;  //!< state of all page sizes; NULL: no computation
+static unsigned long accesses = 0;     //!< number of accesses
+static char *result_name = NULL;       //!< name of the result file
+static int sampling = FALSE;           //!< TRUE: approximate the LRU curve by SHARDS
+static double rate = 1.0;              //!< SHARDS: initial sampling rate
+static int smax = SHARDS_SMAX;         //!< SHARDS: max. number of sampled pages
+static int step = 1;                   //!< SHARDS: the result contains multiples of step frames
+
+static void mrc_close(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adds v at position i of a Fenwick tree.
+ *
+ *  @param      tree The Fenwick tree (MRC_TIMES entries, 1 based).
+ *
+ *  @param      i Position, 1 <= i <= MRC_TIMES.
+ *
+ *  @param      v Value to be added.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void fenwick_add(int *tree, unsigned int i, int v) {
+    for (; i <= MRC_TIMES; i += i & -i) {
+        tree[i] += v;
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes the sum of positions 1 .. i of a Fenwick tree.
+ *
+ *  @param      tree The Fenwick tree.
+ *
+ *  @param      i Last position, 0 <= i <= MRC_TIMES.
+ *
+ *  @return     The sum
+ ****************************************************************************************/
+static int fenwick_sum(const int *tree, unsigned int i) {
+    int sum = 0;
+    for (; i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function renumbers the times of the last accesses to 1 .. k
+ *              (in the same order) when the Fenwick tree is full.
+ *
+ *  @param      s State of a page size.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void compact(struct mrc_size *s) {
+    unsigned int next = 0;
+    int p;
+
+    memset(s->tree, 0, sizeof(s->tree));
+    // at most npages times are in use, so searching the smallest one is cheap enough
+    while (1) {
+        unsigned int min = UINT_MAX;
+        int min_page = VOID_IDX;
+        for (p = 0; p < s->npages; p++) {
+            if (s->last[p] > next && s->last[p] < min) {
+                min = s->last[p];
+                min_page = p;
+            }
+        }
+        if (min_page == VOID_IDX) {
+            break;
+        }
+        // all times greater than next are renumbered in ascending order
+        for (p = 0; p < s->npages; p++) {
+            if (s->last[p] == min) {
+                s->last[p] = next + 1;
+            }
+        }
+        next++;
+        fenwick_add(s->tree, next, 1);
+    }
+    s->now = next;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adds an access to the LRU stack of a page size.
+ *
+ *  @param      s State of the page size.
+ *
+ *  @param      page Accessed page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void lru_stack_access(struct mrc_size *s, int page) {
+    if (s->now == MRC_TIMES) {
+        compact(s);
+    }
+    s->now++;
+    if (s->last[page] != 0) {
+        // distinct pages accessed after the last access to page, plus page itself
+        int d = fenwick_sum(s->tree, s->now - 1) - fenwick_sum(s->tree, s->last[page]) + 1;
+        s->dist[d]++;
+        fenwick_add(s->tree, s->last[page], -1);
+    } else {
+        s->cold++;
+    }
+    fenwick_add(s->tree, s->now, 1);
+    s->last[page] = s->now;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adds an access to a model of physical memory.
+ *
+ *  @param      m The model.
+ *
+ *  @param      algo Page replacement algorithm (VMEM_ALGO_FIFO, _CLOCK or _AGING)
+ *
+ *  @param      page Accessed page.
+ *
+ *  @param      tick TRUE: an aging step follows the access.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void sim_access(struct mrc_sim *m, int algo, int page, int tick) {
+    int f;
+
+    m->pageref[page] = TRUE; // vmaccess sets PTF_REF before the translation
+    f = m->frame_of[page];
+    if (f == VOID_IDX) {
+        m->faults++;
+        if (m->used < m->nframes) {
+            f = m->used++;
+        } else {
+            switch (algo) {
+            case VMEM_ALGO_CLOCK:
+                while (1) {
+                    m->hand = (m->hand == m->nframes - 1) ? 0 : m->hand + 1;
+                    if (!m->pageref[m->page_of[m->hand]]) {
+                        break;
+                    }
+                    m->pageref[m->page_of[m->hand]] = FALSE;
+                }
+                f = m->hand;
+                break;
+            case VMEM_ALGO_AGING:
+                f = aging_find_min(m->age, m->nframes);
+                break;
+            default:
+                m->hand = (m->hand == m->nframes - 1) ? 0 : m->hand + 1;
+                f = m->hand;
+            }
+            m->frame_of[m->page_of[f]] = VOID_IDX;
+        }
+        m->frame_of[page] = f;
+        m->page_of[f] = page;
+        m->age[f] = 0x80; // age of a page that is loaded (again)
+    }
+    if (algo == VMEM_ALGO_AGING) {
+        m->ref[f] = AGING_REF;
+        if (tick) {
+            aging_tick(m->age, m->ref, m->nframes);
+        }
+    }
+}
+
+int mrc_option(const char *arg) {
+    const char *rate_str = "-mrcrate=";
+    const char *max_str = "-mrcmax=";
+    const char *step_str = "-mrcstep=";
+
+    if (0 == strncasecmp(rate_str, arg, strlen(rate_str))) {
+        sampling = TRUE;
+        return 1 == sscanf(arg + strlen(rate_str), "%lf", &rate) && rate > 0 && rate <= 1;
+    }
+    if (0 == strncasecmp(max_str, arg, strlen(max_str))) {
+        sampling = TRUE;
+        return 1 == sscanf(arg + strlen(max_str), "%d", &smax) && smax > 0;
+    }
+    if (0 == strncasecmp(step_str, arg, strlen(step_str))) {
+        return 1 == sscanf(arg + strlen(step_str), "%d", &step) && step > 0;
+    }
+    return FALSE;
+}
+
+void mrc_usage(void) {
+    fprintf(stderr, " -mrcrate=<r> : Sampled LRU miss ratio curve (SHARDS), initial sampling rate 0 < r <= 1\n");
+    fprintf(stderr, " -mrcmax=<n> : Sampled LRU miss ratio curve with at most <n> sampled pages (default %d)\n", SHARDS_SMAX);
+    fprintf(stderr, " -mrcstep=<n> : Sampled curve: physical memory sizes are multiples of <n> frames (default 1)\n");
+}
+
+void mrc_open(const char *name) {
+    int i, a, n, p;
+
+    if (sampling) {
+        shards_open(name, rate, smax, step);
+        return;
+    }
+
+    TEST_AND_EXIT(sizes != NULL, (stderr, "mrc_open: miss ratio curves already started\n"));
+    sizes = calloc(MRC_NSIZES, sizeof(struct mrc_size));
+    TEST_AND_EXIT_ERRNO(sizes == NULL, "calloc failed");
+    result_name = strdup(name);
+    TEST_AND_EXIT_ERRNO(result_name == NULL, "strdup failed");
+    for (i = 0; i < MRC_NSIZES; i++) {
+        sizes[i].pagesize = mrc_pagesizes[i];
+        sizes[i].npages = VMEM_VIRTMEMSIZE / mrc_pagesizes[i];
+        for (a = 0; a < MRC_NALGOS; a++) {
+            for (n = 1; n <= sizes[i].npages; n++) {
+                struct mrc_sim *m = &sizes[i].sim[a][n - 1];
+                m->nframes = n;
+                m->hand = -1;
+                for (p = 0; p < MRC_MAXPAGES; p++) {
+                    m->frame_of[p] = VOID_IDX;
+                }
+            }
+        }
+    }
+    accesses = 0;
+    atexit(mrc_close);
+}
+
+void mrc_access(int address, int g_count) {
+    int tick = ((g_count + 1) % UPDATE_AGE_COUNT) == 0;
+    int i, a, n;
+
+    if (sampling) {
+        shards_access(address);
+        return;
+    }
+    if (address < 0 || address >= VMEM_VIRTMEMSIZE) {
+        return; // vmaccess will terminate the program
+    }
+    accesses++;
+    for (i = 0; i < MRC_NSIZES; i++) {
+        struct mrc_size *s = &sizes[i];
+        int page = address / s->pagesize;
+        lru_stack_access(s, page);
+        for (a = 0; a < MRC_NALGOS; a++) {
+            for (n = 0; n < s->npages; n++) {
+                sim_access(&s->sim[a][n], a, page, tick);
+            }
+        }
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes the miss ratio curves to the result file.
+ *              It will be registered via atexit.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void mrc_close(void) {
+    FILE *f = fopen(result_name, "w");
+    int i, n;
+
+    TEST_AND_EXIT_ERRNO(f == NULL, "Error creating miss ratio curve file");
+    fprintf(f, "pagesize,frames,physmem,accesses,lru,fifo,clock,aging,lru_ratio,fifo_ratio,clock_ratio,aging_ratio\n");
+    for (i = 0; i < MRC_NSIZES; i++) {
+        struct mrc_size *s = &sizes[i];
+        unsigned long lru = accesses;  // faults of LRU with n frames: accesses with distance > n
+        double div = accesses ? (double) accesses : 1.0;
+        for (n = 1; n <= s->npages; n++) {
+            unsigned long fifo = s->sim[VMEM_ALGO_FIFO][n - 1].faults;
+            unsigned long clock = s->sim[VMEM_ALGO_CLOCK][n - 1].faults;
+            unsigned long aging = s->sim[VMEM_ALGO_AGING][n - 1].faults;
+            lru -= s->dist[n];
+            fprintf(f, "%d,%d,%d,%lu,%lu,%lu,%lu,%lu,%.6f,%.6f,%.6f,%.6f\n",
+                    s->pagesize, n, n * s->pagesize, accesses, lru, fifo, clock, aging,
+                    lru / div, fifo / div, clock / div, aging / div);
+        }
+    }
+    fclose(f);
+}
+
+// EOF
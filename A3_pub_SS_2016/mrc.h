@@ -0,0 +1,75 @@
+/**
+ * @file mrc.h
+ * @brief Header file of the miss ratio curve module.
+ *
+ * The module computes the number of page faults of an access stream for all
+ * sizes of physical memory and all page sizes (8, 16, 32, 64) in one pass:
+ *
+ *   - LRU: Mattson's stack algorithm. The stack distance of an access is the
+ *     number of distinct pages accessed since the last access to the same page.
+ *     It is computed by a Fenwick tree over the times of the last access of
+ *     each page. An access faults with n frames iff its stack distance is > n.
+ *   - FIFO, CLOCK and AGING are no stack algorithms. They are simulated for
+ *     each number of frames by small models of find_remove_fifo,
+ *     find_remove_clock and find_remove_aging of mmcore.c, including the
+ *     aging steps every UPDATE_AGE_COUNT accesses.
+ *
+ * The accesses will be fed by vmaccess (vmem_mrc) or by vmreplay -mrc.
+ * The result is written as CSV when the program terminates:
+ *
+ *   pagesize,frames,physmem,accesses,lru,fifo,clock,aging,lru_ratio,fifo_ratio,clock_ratio,aging_ratio
+ *
+ * With -mrcrate or -mrcmax (see mrc_option) only a sample of the pages will be
+ * processed in constant memory and the LRU curve will be approximated, see shards.h.
+ */
+
+#ifndef MRC_H
+#define MRC_H
+
+#define MRC_ENV    "VMEM_MRC"  //!< Environment variable that defines the result file of vmaccess
+#define MRC_TIMES  (1 << 16)   //!< Size of the Fenwick tree; times will be compacted when it is full
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans one command line parameter of the miss ratio curve
+ *              module. It must be called before mrc_open.
+ *
+ *  @param      arg The parameter.
+ *
+ *  @return     TRUE if arg is a valid parameter of the mrc module, otherwise FALSE.
+ ****************************************************************************************/
+int mrc_option(const char *arg);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the usage information of the parameters 
+ *              scanned by mrc_option to stderr.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void mrc_usage(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function starts the computation of the miss ratio curves. The
+ *              result will be written to a file by atexit.
+ *
+ *  @param      name Name of the result file (CSV).
+ *
+ *  @return     void
+ ****************************************************************************************/
+void mrc_open(const char *name);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adds an access to the miss ratio curves.
+ *
+ *  @param      address Accessed virtual memory address.
+ *
+ *  @param      g_count Global access counter before the access (vmem->adm.g_count).
+ *
+ *  @return     void
+ ****************************************************************************************/
+void mrc_access(int address, int g_count);
+
+#endif /* MRC_H */
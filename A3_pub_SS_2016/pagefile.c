@@ -9,29 +9,394 @@
   *
   */
 
+#define _GNU_SOURCE // O_DIRECT
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include "debug.h"
 #include "vmem.h"
 #include "pagefile.h"
+#include "instance.h"
+#include "uring.h"
 
 #define MMANAGE_PFNAME "./pagefile.bin" //!< Pagefile name 
 #define SEED_PF        070514           //!< Get reproducable pseudo-random numbers to init pagefile
+#define PAGEFILE_SIZE  (VMEM_PAGESIZE * VMEM_NGPAGES * sizeof(int)) //!< Size of pagefile in bytes
+#define PAGE_BYTES     (VMEM_PAGESIZE * sizeof(int))               //!< Size of a page in bytes
+#define IO_ALIGN       4096       //!< Alignment of the I/O buffers of the uring backend (O_DIRECT)
+#define DIRECT_BLOCK   512        //!< O_DIRECT transfers must be a multiple of this size
+#define SLOT_BYTES     ((PAGE_BYTES + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN) //!< Size of a staging buffer
+#define URING_SLOTS    16         //!< Number of staging buffers, i.e. max. number of writes in flight
+#define URING_READ     URING_SLOTS //!< user_data of a read request; writes use the staging buffer index
+#define PAGEFILE_WORDS ((VMEM_NGPAGES + 63) / 64) //!< Number of 64 bit words of bitmap written
 
-static FILE *pagefile = NULL;           //!< Reference to pagefile
+static FILE *pagefile = NULL;           //!< Reference to pagefile (stdio backend)
+static int backend = PAGEFILE_STDIO;    //!< Selected backend
+static int pf_fd = -1;                  //!< File descriptor of pagefile (mmap backend)
+static unsigned char *pf_map = NULL;    //!< Mapping of pagefile (mmap backend)
+static int advice = -1;                 //!< madvise hint of the mapping; -1: none
+static int msync_batch = 0;             //!< msync after each msync_batch stores; 0: never
+static int unsynced_stores = 0;         //!< Number of stores since last msync
+static int use_direct = FALSE;          //!< O_DIRECT requested for the uring backend
+static int pf_direct = FALSE;           //!< pf_fd has been opened with O_DIRECT
+static struct uring ring = { .fd = -1 }; //!< Ring of the uring backend; fd == -1: use pread / pwrite
+static unsigned char *staging = NULL;   //!< URING_SLOTS staging buffers of SLOT_BYTES
+static int staged_page[URING_SLOTS];    //!< Page written from each staging buffer; VOID_IDX: buffer free
+static unsigned char *bounce = NULL;    //!< Aligned buffer for reads with O_DIRECT
+static int read_done = FALSE;           //!< The pending read of the uring backend has completed
+static int compat = FALSE;              //!< Write the complete pagefile as byte stream of random_r at start
+static unsigned long long written[PAGEFILE_WORDS]; //!< Bit set: page has been written to the pagefile
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER; //!< Serializes the transfers of backends with shared state
+
+/**
+ *****************************************************************************************
+ *  @brief      This function checks whether a page has been written to the pagefile.
+ *
+ *  @param      pt_idx Index of the page.
+ *
+ *  @return     TRUE if the page is stored in the pagefile.
+ ****************************************************************************************/
+static int is_written(int pt_idx);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function locks io_lock unless the backend can transfer pages 
+ *              concurrently: the mmap backend and pread / pwrite without O_DIRECT.
+ *
+ *  @return     TRUE if io_lock has been locked.
+ ****************************************************************************************/
+static int io_begin(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function unlocks io_lock if it has been locked by io_begin.
+ *
+ *  @param      locked Result of io_begin.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void io_end(int locked);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function generates the content of the pagefile of compatibility 
+ *              mode: the byte stream of random_r seeded with SEED_PF.
+ *
+ *  @param      content Buffer of PAGEFILE_SIZE bytes.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void compat_content(unsigned char *content);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function generates the initial content of a page that has never 
+ *              been written. Each 64 bit word is SplitMix64 of a counter made of SEED_PF 
+ *              and the position of the word in the pagefile, so the content does not 
+ *              depend on the order in which pages are fetched.
+ *
+ *  @param      pt_idx Index of the page.
+ *
+ *  @param      frame_start Starting address of frame that should store the page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void synthesize_page(int pt_idx, int *frame_start);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function creates the file of the uring backend and opens the ring.
+ *
+ *  @param      name Name of the pagefile.
+ *
+ *  @param      content Content of the new pagefile (PAGEFILE_SIZE bytes) or NULL
+ *              for a sparse file.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void uring_open(const char *name, const unsigned char *content);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function handles all completions of the ring.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void uring_reap(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function waits until no write of a page is in flight. 
+ *              pt_idx == VOID_IDX waits for all writes.
+ *
+ *  @param      pt_idx Index of the page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void uring_wait_page(int pt_idx);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function copies a page into a free staging buffer and queues its 
+ *              write. It will be submitted by the next io_uring_enter.
+ *
+ *  @param      pt_idx Index of the page.
+ *
+ *  @param      frame_start Starting address of the frame that contains the page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void uring_stage(int pt_idx, int *frame_start);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function reads a page. All queued writes will be submitted by the
+ *              same io_uring_enter.
+ *
+ *  @param      pt_idx Index of the page.
+ *
+ *  @param      frame_start Starting address of the frame that should store the page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void uring_read(int pt_idx, int *frame_start);
+
+int pagefile_option(const char *arg) {
+    const char *advise_str = "-pfadvise=";
+    const char *msync_str = "-msync=";
+
+    if (0 == strcasecmp("-pf=stdio", arg)) {
+        backend = PAGEFILE_STDIO;
+        return TRUE;
+    }
+    if (0 == strcasecmp("-pf=mmap", arg)) {
+        backend = PAGEFILE_MMAP;
+        return TRUE;
+    }
+    if (0 == strcasecmp("-pf=uring", arg)) {
+        backend = PAGEFILE_URING;
+        return TRUE;
+    }
+    if (0 == strcasecmp("-pfdirect", arg)) {
+        use_direct = TRUE;
+        return TRUE;
+    }
+    if (0 == strcasecmp("-pfcompat", arg)) {
+        compat = TRUE;
+        return TRUE;
+    }
+    if (0 == strncasecmp(advise_str, arg, strlen(advise_str))) {
+        arg += strlen(advise_str);
+        advice = (0 == strcasecmp("normal", arg))     ? MADV_NORMAL :
+                 (0 == strcasecmp("random", arg))     ? MADV_RANDOM :
+                 (0 == strcasecmp("sequential", arg)) ? MADV_SEQUENTIAL :
+                 (0 == strcasecmp("willneed", arg))   ? MADV_WILLNEED : -1;
+        return advice != -1;
+    }
+    if (0 == strncasecmp(msync_str, arg, strlen(msync_str))) {
+        return 1 == sscanf(arg + strlen(msync_str), "%d", &msync_batch) && msync_batch >= 0;
+    }
+    return FALSE;
+}
+
+void pagefile_usage(void) {
+    fprintf(stderr, " -pf=stdio|mmap|uring : Pagefile backend (default stdio)\n");
+    fprintf(stderr, " -pfadvise=normal|random|sequential|willneed : madvise hint of -pf=mmap\n");
+    fprintf(stderr, " -msync=<n> : -pf=mmap flushes the pagefile asynchronously after <n> stores (default 0: never)\n");
+    fprintf(stderr, " -pfcompat : Write the complete pagefile at start like former versions\n");
+    fprintf(stderr, " -pfdirect : -pf=uring opens the pagefile with O_DIRECT (pages of a multiple of %d bytes only)\n", DIRECT_BLOCK);
+}
 
 void init_pagefile(void) {
+    unsigned char *content = NULL;
+    char name[PATH_MAX];
     int i;
+
     /* Always generate a new file. 
        Otherwise: Run into problem if sizes change */
-    pagefile = fopen(MMANAGE_PFNAME, "w+");
-    TEST_AND_EXIT_ERRNO(!pagefile, "Error creating pagefile with w+");
+    instance_name(MMANAGE_PFNAME, name, sizeof(name));
+    for (i = 0; i < PAGEFILE_WORDS; i++) {
+        written[i] = compat ? ~0ULL : 0;
+    }
+    if (compat) {
+        content = malloc(PAGEFILE_SIZE);
+        TEST_AND_EXIT_ERRNO(content == NULL, "malloc failed");
+        compat_content(content);
+    }
+    if (backend == PAGEFILE_MMAP) {
+        pf_fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        TEST_AND_EXIT_ERRNO(pf_fd == -1, "Error creating pagefile");
+        TEST_AND_EXIT_ERRNO(ftruncate(pf_fd, PAGEFILE_SIZE) == -1, "Error resizing pagefile");
+        pf_map = mmap(NULL, PAGEFILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, pf_fd, 0);
+        TEST_AND_EXIT_ERRNO(pf_map == MAP_FAILED, "Error mapping pagefile");
+        unsynced_stores = 0;
+        if (content != NULL) {
+            memcpy(pf_map, content, PAGEFILE_SIZE);
+        }
+        if (advice != -1) {
+            TEST_AND_EXIT_ERRNO(madvise(pf_map, PAGEFILE_SIZE, advice) == -1, "madvise of pagefile failed");
+        }
+    } else if (backend == PAGEFILE_URING) {
+        uring_open(name, content);
+    } else {
+        pagefile = fopen(name, "w+");
+        TEST_AND_EXIT_ERRNO(!pagefile, "Error creating pagefile with w+");
+        if (content != NULL) {
+            TEST_AND_EXIT_ERRNO(fwrite(content, 1, PAGEFILE_SIZE, pagefile) != PAGEFILE_SIZE, "Error writing pagefile");
+        } else {
+            TEST_AND_EXIT_ERRNO(ftruncate(fileno(pagefile), PAGEFILE_SIZE) == -1, "Error resizing pagefile");
+        }
+    }
+    free(content);
+}
+
+void compat_content(unsigned char *content) {
+    int i;
+    int32_t rnd;
+    char rnd_state[128];               // same state size as used by rand()
+    struct random_data rnd_data = {};  // private state: don't disturb rand() of an in-process application
+
+    initstate_r(SEED_PF, rnd_state, sizeof(rnd_state), &rnd_data);
+    for(i = 0; i < PAGEFILE_SIZE; i++) {
+        random_r(&rnd_data, &rnd);
+        content[i] = rnd % (UCHAR_MAX + 1);
+    }
+}
+
+void synthesize_page(int pt_idx, int *frame_start) {
+    unsigned long long word = (unsigned long long) pt_idx * (PAGE_BYTES / sizeof(word));
+    unsigned char *dst = (unsigned char *) frame_start;
+    int i;
+
+    for (i = 0; i < PAGE_BYTES; i += sizeof(word), word++) {
+        unsigned long long z = ((unsigned long long) SEED_PF << 32) + word + 0x9E3779B97F4A7C15ULL;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;  // SplitMix64 finalizer
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z = z ^ (z >> 31);
+        memcpy(dst + i, &z, sizeof(z));
+    }
+}
+
+void uring_open(const char *name, const unsigned char *content) {
+    size_t done = 0;
+    int i;
+
+    pf_fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    TEST_AND_EXIT_ERRNO(pf_fd == -1, "Error creating pagefile");
+    if (content == NULL) {
+        TEST_AND_EXIT_ERRNO(ftruncate(pf_fd, PAGEFILE_SIZE) == -1, "Error resizing pagefile");
+        done = PAGEFILE_SIZE;
+    }
+    while (done < PAGEFILE_SIZE) {
+        ssize_t n = write(pf_fd, content + done, PAGEFILE_SIZE - done);
+        TEST_AND_EXIT_ERRNO(n == -1, "Error writing pagefile");
+        done += n;
+    }
+    pf_direct = FALSE;
+    if (use_direct && PAGE_BYTES % DIRECT_BLOCK != 0) {
+        fprintf(stderr, "O_DIRECT requires pages of a multiple of %d bytes, using buffered I/O\n", DIRECT_BLOCK);
+    } else if (use_direct) {
+        TEST_AND_EXIT_ERRNO(close(pf_fd) == -1, "close of pagefile failed");
+        pf_fd = open(name, O_RDWR | O_DIRECT);
+        TEST_AND_EXIT_ERRNO(pf_fd == -1, "Error opening pagefile with O_DIRECT");
+        pf_direct = TRUE;
+    }
+
+    TEST_AND_EXIT(posix_memalign((void **) &staging, IO_ALIGN, URING_SLOTS * SLOT_BYTES) != 0, 
+                  (stderr, "posix_memalign failed\n"));
+    TEST_AND_EXIT(posix_memalign((void **) &bounce, IO_ALIGN, SLOT_BYTES) != 0, 
+                  (stderr, "posix_memalign failed\n"));
+    for (i = 0; i < URING_SLOTS; i++) {
+        staged_page[i] = VOID_IDX;
+    }
+    if (uring_init(&ring, 2 * URING_SLOTS) == -1) {
+        fprintf(stderr, "io_uring not available (%s), using pread/pwrite\n", strerror(errno));
+    }
+}
+
+void uring_reap(void) {
+    unsigned long long user_data;
+    int res;
+
+    while (uring_complete(&ring, &user_data, &res)) {
+        TEST_AND_EXIT(res < 0, (stderr, "io_uring %s of pagefile failed: %s\n", 
+                      (user_data == URING_READ) ? "read" : "write", strerror(-res)));
+        TEST_AND_EXIT(res != PAGE_BYTES, (stderr, "io_uring: short transfer of pagefile\n"));
+        if (user_data == URING_READ) {
+            read_done = TRUE;
+        } else {
+            staged_page[user_data] = VOID_IDX;
+        }
+    }
+}
+
+void uring_wait_page(int pt_idx) {
+    int i;
+
+    while (1) {
+        uring_reap();
+        for (i = 0; i < URING_SLOTS; i++) {
+            if (staged_page[i] != VOID_IDX && (pt_idx == VOID_IDX || staged_page[i] == pt_idx)) {
+                break;
+            }
+        }
+        if (i == URING_SLOTS) {
+            return;
+        }
+        uring_submit(&ring, 1);
+    }
+}
+
+void uring_stage(int pt_idx, int *frame_start) {
+    int offset = pt_idx * PAGE_BYTES;
+    int i;
+
+    uring_wait_page(pt_idx); // writes of the same page must not overtake each other
+    while (1) {
+        for (i = 0; i < URING_SLOTS && staged_page[i] != VOID_IDX; i++) {
+        }
+        if (i < URING_SLOTS) {
+            break;
+        }
+        uring_submit(&ring, 1); // all staging buffers in use
+        uring_reap();
+    }
+    memcpy(staging + i * SLOT_BYTES, frame_start, PAGE_BYTES);
+    staged_page[i] = pt_idx;
+    uring_queue(&ring, IORING_OP_WRITE, pf_fd, staging + i * SLOT_BYTES, PAGE_BYTES, offset, i);
+}
+
+void uring_read(int pt_idx, int *frame_start) {
+    void *buf = pf_direct ? (void *) bounce : (void *) frame_start;
+
+    uring_wait_page(pt_idx); // a write of this page may still be in flight
+    read_done = FALSE;
+    uring_queue(&ring, IORING_OP_READ, pf_fd, buf, PAGE_BYTES, pt_idx * PAGE_BYTES, URING_READ);
+    while (!read_done) {
+        uring_submit(&ring, 1);
+        uring_reap();
+    }
+    if (pf_direct) {
+        memcpy(frame_start, bounce, PAGE_BYTES);
+    }
+}
+
+int is_written(int pt_idx) {
+    return (__atomic_load_n(&written[pt_idx / 64], __ATOMIC_ACQUIRE) & (1ULL << (pt_idx % 64))) != 0;
+}
 
-    srand(SEED_PF);
+int io_begin(void) {
+    if (backend == PAGEFILE_MMAP || (backend == PAGEFILE_URING && ring.fd == -1 && !pf_direct)) {
+        return FALSE; // no file position, no buffers shared between transfers
+    }
+    pthread_mutex_lock(&io_lock);
+    return TRUE;
+}
 
-    for(i = 0; i < (VMEM_PAGESIZE * VMEM_NPAGES * sizeof(int)); i++) {
-        unsigned char rndval = rand() % (UCHAR_MAX + 1);
-        fwrite(&rndval, 1, 1, pagefile);
+void io_end(int locked) {
+    if (locked) {
+        pthread_mutex_unlock(&io_lock);
     }
 }
 
@@ -39,31 +404,110 @@ void fetch_page_from_pagefile(int pt_idx, int *frame_start) {
     // check page number pt_itx
 
     TEST_AND_EXIT(pt_idx <  0,           (stderr, "find_page: pt_idx out of range\n"));
-    TEST_AND_EXIT(pt_idx >= VMEM_NPAGES, (stderr, "find_page: pt_idx out of range\n"));
+    TEST_AND_EXIT(pt_idx >= VMEM_NGPAGES, (stderr, "find_page: pt_idx out of range\n"));
     
     int offset = pt_idx * sizeof(int) * VMEM_PAGESIZE;
+    int locked;
 
-    TEST_AND_EXIT_ERRNO(fseek(pagefile, offset, SEEK_SET) == -1, "Positioning in pagefile failed!");
-    TEST_AND_EXIT_ERRNO(fread(frame_start, sizeof(int), VMEM_PAGESIZE, pagefile) != VMEM_PAGESIZE, "Error reading page from disk");
+    if (!is_written(pt_idx)) {
+        synthesize_page(pt_idx, frame_start); // never written: not stored in the pagefile
+        return;
+    }
+    if (backend == PAGEFILE_MMAP) {
+        memcpy(frame_start, pf_map + offset, PAGE_BYTES);
+        return;
+    }
+    locked = io_begin();
+    if (backend == PAGEFILE_URING && ring.fd != -1) {
+        uring_read(pt_idx, frame_start);
+    } else if (backend == PAGEFILE_URING) {
+        void *buf = pf_direct ? (void *) bounce : (void *) frame_start;
+        TEST_AND_EXIT_ERRNO(pread(pf_fd, buf, PAGE_BYTES, offset) != PAGE_BYTES, "Error reading page from disk");
+        if (pf_direct) {
+            memcpy(frame_start, bounce, PAGE_BYTES);
+        }
+    } else {
+        TEST_AND_EXIT_ERRNO(fseek(pagefile, offset, SEEK_SET) == -1, "Positioning in pagefile failed!");
+        TEST_AND_EXIT_ERRNO(fread(frame_start, sizeof(int), VMEM_PAGESIZE, pagefile) != VMEM_PAGESIZE, "Error reading page from disk");
+    }
+    io_end(locked);
 }
 
 void store_page_to_pagefile(int pt_idx, int *frame_start) {
-	if(pt_idx >= VMEM_NPAGES){
+	if(pt_idx >= VMEM_NGPAGES){
 		fprintf(stderr,"toll %i",pt_idx);
 	}
     // check page number pt_itx
     TEST_AND_EXIT(pt_idx <  0,           (stderr, "store_page: pt_idx out of range\n"));
-    TEST_AND_EXIT(pt_idx >= VMEM_NPAGES, (stderr, "store_page: pt_idx out of range\n"));
+    TEST_AND_EXIT(pt_idx >= VMEM_NGPAGES, (stderr, "store_page: pt_idx out of range\n"));
 
 
     int offset = pt_idx * sizeof(int) * VMEM_PAGESIZE;
+    int locked;
 
-    TEST_AND_EXIT_ERRNO(fseek(pagefile, offset, SEEK_SET) == -1, "Positioning in pagefile failed! ");
-    TEST_AND_EXIT_ERRNO(fwrite(frame_start, sizeof(int), VMEM_PAGESIZE, pagefile) != VMEM_PAGESIZE, "Error writing page to disk");
+    if (backend == PAGEFILE_MMAP) {
+        memcpy(pf_map + offset, frame_start, PAGE_BYTES);
+        __atomic_fetch_or(&written[pt_idx / 64], 1ULL << (pt_idx % 64), __ATOMIC_RELEASE);
+        if (msync_batch > 0 && __atomic_add_fetch(&unsynced_stores, 1, __ATOMIC_RELAXED) >= msync_batch) {
+            __atomic_store_n(&unsynced_stores, 0, __ATOMIC_RELAXED);
+            TEST_AND_EXIT_ERRNO(msync(pf_map, PAGEFILE_SIZE, MS_ASYNC) == -1, "msync of pagefile failed");
+        }
+        return;
+    }
+    locked = io_begin();
+    __atomic_fetch_or(&written[pt_idx / 64], 1ULL << (pt_idx % 64), __ATOMIC_RELEASE);
+    if (backend == PAGEFILE_URING && ring.fd != -1) {
+        uring_stage(pt_idx, frame_start);
+        uring_submit(&ring, 0);
+    } else if (backend == PAGEFILE_URING) {
+        void *buf = frame_start;
+        if (pf_direct) {
+            memcpy(bounce, frame_start, PAGE_BYTES);
+            buf = bounce;
+        }
+        TEST_AND_EXIT_ERRNO(pwrite(pf_fd, buf, PAGE_BYTES, offset) != PAGE_BYTES, "Error writing page to disk");
+    } else {
+        TEST_AND_EXIT_ERRNO(fseek(pagefile, offset, SEEK_SET) == -1, "Positioning in pagefile failed! ");
+        TEST_AND_EXIT_ERRNO(fwrite(frame_start, sizeof(int), VMEM_PAGESIZE, pagefile) != VMEM_PAGESIZE, "Error writing page to disk");
+    }
+    io_end(locked);
 }
 
 
+void exchange_page_with_pagefile(int store_idx, int *store_frame, int fetch_idx, int *fetch_frame) {
+    if (backend == PAGEFILE_URING && ring.fd != -1 && is_written(fetch_idx)) {
+        TEST_AND_EXIT(store_idx < 0 || store_idx >= VMEM_NGPAGES, (stderr, "store_page: pt_idx out of range\n"));
+        TEST_AND_EXIT(fetch_idx < 0 || fetch_idx >= VMEM_NGPAGES, (stderr, "find_page: pt_idx out of range\n"));
+        pthread_mutex_lock(&io_lock);
+        __atomic_fetch_or(&written[store_idx / 64], 1ULL << (store_idx % 64), __ATOMIC_RELEASE);
+        uring_stage(store_idx, store_frame); // the frame may be overwritten now
+        uring_read(fetch_idx, fetch_frame);  // submits write and read together
+        pthread_mutex_unlock(&io_lock);
+        return;
+    }
+    store_page_to_pagefile(store_idx, store_frame);
+    fetch_page_from_pagefile(fetch_idx, fetch_frame);
+}
+
 void cleanup_pagefile(void) {
+    if (backend == PAGEFILE_URING) {
+        if (ring.fd != -1) {
+            uring_wait_page(VOID_IDX);
+            uring_exit(&ring);
+        }
+        TEST_AND_EXIT_ERRNO(close(pf_fd) == -1, "close in cleanup_pagefile failed! ");
+        free(staging);
+        free(bounce);
+        return;
+    }
+    if (backend == PAGEFILE_MMAP) {
+        if (msync_batch > 0) {
+            TEST_AND_EXIT_ERRNO(msync(pf_map, PAGEFILE_SIZE, MS_SYNC) == -1, "msync in cleanup_pagefile failed! ");
+        }
+        TEST_AND_EXIT_ERRNO(munmap(pf_map, PAGEFILE_SIZE) == -1, "munmap in cleanup_pagefile failed! ");
+        TEST_AND_EXIT_ERRNO(close(pf_fd) == -1, "close in cleanup_pagefile failed! ");
+        return;
+    }
     TEST_AND_EXIT_ERRNO(fclose(pagefile) == -1, "fclose in cleanup_pagefile failed! ")
 }
 
@@ -3,11 +3,65 @@
  * @author Franz Korf, HAW Hamburg 
  * @date Dec 2015
  * @brief Header file of module for input / output of memory file.
+ *
+ * Two backends are available:
+ *  - stdio: every page transfer is a fseek followed by fread / fwrite (default).
+ *  - mmap: the pagefile is mapped into the address space, a page transfer is a
+ *    memcpy between the mapping and the frame. The kernel can be given an madvise
+ *    hint about the access pattern. Modified pages of the mapping can be flushed 
+ *    asynchronously after a given number of stores (msync batching).
+ *  - uring: page transfers are submitted via io_uring. A page that will be stored is
+ *    copied into a staging buffer first, so the frame can be refilled at once and 
+ *    the write is asynchronous. exchange_page_with_pagefile submits the write of the
+ *    victim and the read of the requested page by one system call, so a page fault
+ *    waits for one I/O only. Optionally the pagefile will be opened with O_DIRECT.
+ *    If io_uring is not available, pread / pwrite will be used.
+ * The pagefile is sparse: it holds only pages that have been written. The initial
+ * content of any other page will be generated when it is fetched (counter based 
+ * SplitMix64, keyed by SEED_PF and the position in the pagefile), so startup does
+ * not depend on the size of the virtual memory. Compatibility mode writes the 
+ * complete pagefile at start with the byte stream of former versions.
+ * The pagefile holds the pages of all address spaces; pages are numbered by VMEM_GPAGE.
+ * Transfers of different pages may be called by several threads at the same time.
+ * The mmap backend and pread / pwrite without O_DIRECT run them concurrently, the 
+ * other backends share a file position or buffers and serialize them by a mutex.
+ * The caller must not transfer the same page concurrently.
+ * The backend has to be selected before init_pagefile is called.
  */
 
 #ifndef PAGEFILE_H
 #define PAGEFILE_H
 
+#define PAGEFILE_STDIO 0 //!< Backend based on stdio
+#define PAGEFILE_MMAP  1 //!< Backend based on a shared file mapping
+#define PAGEFILE_URING 2 //!< Backend based on io_uring
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans a command line parameter of the pagefile module:
+ *
+ *   -pf=stdio|mmap|uring : backend
+ *   -pfadvise=normal|random|sequential|willneed : madvise hint of the mmap backend
+ *   -msync=<n> : msync(MS_ASYNC) after each <n> stores of the mmap backend; 0: never
+ *   -pfcompat : compatibility mode
+ *   -pfdirect : open the pagefile of the uring backend with O_DIRECT. This requires 
+ *               pages of a multiple of 512 bytes, otherwise it will be ignored.
+ *
+ *  @param      arg The parameter.
+ *
+ *  @return     TRUE if arg is a valid parameter of the pagefile module, otherwise FALSE.
+ ****************************************************************************************/
+int pagefile_option(const char *arg);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the usage information of the parameters 
+ *              scanned by pagefile_option to stderr.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void pagefile_usage(void);
+
 /**
  *****************************************************************************************
  *  @brief      This function creates and initializes a new pagefile.
@@ -42,6 +96,24 @@ void fetch_page_from_pagefile(int pt_idx, int *frame_start);
  ****************************************************************************************/
 void store_page_to_pagefile(int pt_idx, int *frame_start);
 
+/**
+ *****************************************************************************************
+ *  @brief      This function writes a page to pagefile and fetches another page into
+ *              the same or another frame. The write will be done before the frame
+ *              is overwritten.
+ *
+ *  @param      store_idx Index of the page that should be written to pagefile.
+ * 
+ *  @param      store_frame Starting address of the frame that contains the page store_idx.
+ *
+ *  @param      fetch_idx Index of the page that should be fetched.
+ * 
+ *  @param      fetch_frame Starting address of frame that should store the page fetch_idx.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void exchange_page_with_pagefile(int store_idx, int *store_frame, int fetch_idx, int *fetch_frame);
+
 /**
  *****************************************************************************************
  *  @brief      This function cleans and closes page file module.
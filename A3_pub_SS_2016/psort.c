@@ -0,0 +1,656 @@
+/**
+ * @file psort.c
+ * @brief This module implements the parallel sort algorithms of vmappl.
+ *        See psort.h for the algorithms.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include "vmem.h"
+#include "vmaccess.h"
+#include "psort.h"
+#include "debug.h"
+#include "mytypes.h"
+
+/**
+ * A range of the array that has to be sorted
+ */
+struct psort_task {
+    int l;                                     //!< address of the left-most element
+    int r;                                     //!< address of the right-most element
+};
+
+/**
+ * A thread of a parallel sort. The deque of unsorted ranges is used by pquicksort:
+ * the owner pushes and pops ranges at the bottom, other threads steal at the top.
+ */
+struct psort_worker {
+    pthread_t thread;                          //!< the thread
+    int id;                                    //!< index in workers
+    pthread_mutex_t lock;                      //!< protects top, bottom and tasks
+    unsigned int top;                          //!< next range to be stolen
+    unsigned int bottom;                       //!< next free entry
+    struct psort_task tasks[PSORT_DEQUE_SIZE]; //!< ring buffer, index modulo PSORT_DEQUE_SIZE
+    unsigned long steals;                      //!< number of ranges stolen by this thread
+} __attribute__((aligned(VMEM_CACHELINE)));
+
+/*
+ * static variables
+ */
+static int threads = PSORT_THREADS;                    //!< number of threads
+static struct psort_worker workers[PSORT_MAXTHREADS];  //!< all threads
+static int n = 0;                                      //!< length of the array
+static int legacy = FALSE;                             //!< TRUE: exchanges by vmem_write, see psort_legacy
+static long pending = 0;                               //!< pquicksort: ranges pushed and not sorted yet
+static pthread_barrier_t barrier;                      //!< pmergesort, samplesort: end of a phase
+static int splitters[PSORT_MAXTHREADS];                //!< samplesort: bucket b holds values <= splitters[b]
+static int counts[PSORT_MAXTHREADS][PSORT_MAXTHREADS]; //!< samplesort: elements of chunk t in bucket b
+
+int psort_option(const char *arg) {
+    const char *threads_str = "-threads=";
+
+    if (0 == strncasecmp(threads_str, arg, strlen(threads_str))) {
+        return 1 == sscanf(arg + strlen(threads_str), "%d", &threads) && threads > 0 && threads <= PSORT_MAXTHREADS;
+    }
+    return FALSE;
+}
+
+void psort_usage(void) {
+    fprintf(stderr, " -threads=<n> : Threads of -pquicksort, -pmergesort and -samplesort, 1 .. %d (default %d)\n",
+            PSORT_MAXTHREADS, PSORT_THREADS);
+}
+
+int psort_threads(void) {
+    return threads;
+}
+
+void psort_legacy(void) {
+    legacy = TRUE;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function copies a range of virtual memory in blocks of PSORT_BLOCK.
+ *
+ *  @param      dst Address of the destination.
+ *
+ *  @param      src Address of the source.
+ *
+ *  @param      count Number of ints.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void copy_range(int dst, int src, int count) {
+    int buf[PSORT_BLOCK];
+
+    while (count > 0) {
+        int c = (count < PSORT_BLOCK) ? count : PSORT_BLOCK;
+        vmem_read_range(src, buf, c);
+        vmem_write_range(dst, buf, c);
+        src += c;
+        dst += c;
+        count -= c;
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sorts a range of at most PSORT_CUTOFF elements by insertion
+ *              sort in a local buffer.
+ *
+ *  @param      l address of the left-most element
+ *
+ *  @param      r address of the right-most element
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void sort_small(int l, int r) {
+    int buf[PSORT_CUTOFF];
+    int count = r - l + 1;
+    int i, j;
+
+    if (count < 2) {
+        return;
+    }
+    vmem_read_range(l, buf, count);
+    for (i = 1; i < count; i++) {
+        int v = buf[i];
+        for (j = i; j > 0 && buf[j - 1] > v; j--) {
+            buf[j] = buf[j - 1];
+        }
+        buf[j] = v;
+    }
+    vmem_write_range(l, buf, count);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function partitions a range around the median of its first, middle
+ *              and last element. The three elements are sorted in place (Sedgewick), so
+ *              the first and the last one bound the scans, and the median becomes the
+ *              pivot at r - 1. Ascending and descending input are split in halves.
+ *              Each exchange is done by vmem_swap. With psort_legacy the values read 
+ *              while scanning are kept and the exchange writes two elements without 
+ *              reading them again.
+ *
+ *  @param      l address of the left-most element
+ *
+ *  @param      r address of the right-most element, r - l >= 2
+ *
+ *  @return     Address of the pivot: elements left of it are not greater, elements
+ *              right of it are not smaller.
+ ****************************************************************************************/
+static int partition(int l, int r) {
+    int m = l + (r - l) / 2;
+    int vl = vmem_read(l);
+    int vm = vmem_read(m);
+    int vr = vmem_read(r);
+    int i = l + 1;
+    int j = r - 2;
+    int p = 0;
+    int t = 0;
+    int vi = 0;
+    int vj = 0;
+
+    // sort the three samples: vl <= vm <= vr
+    if (vm < vl) {
+        t = vl;
+        vl = vm;
+        vm = t;
+    }
+    if (vr < vm) {
+        t = vm;
+        vm = vr;
+        vr = t;
+        if (vm < vl) {
+            t = vl;
+            vl = vm;
+            vm = t;
+        }
+    }
+    p = vm;
+    vmem_write(l, vl);
+    vmem_write(r, vr);
+    if (m != r - 1) {
+        vmem_write(m, vmem_read(r - 1));
+    }
+    vmem_write(r - 1, p);
+    while (1) {
+        while ((vi = vmem_read(i)) < p) {
+            i++;
+        }
+        while (j > i && (vj = vmem_read(j)) >= p) {
+            j--;
+        }
+        if (i >= j) {
+            break;
+        }
+        if (legacy) {
+            vmem_write(i, vj);
+            vmem_write(j, vi);
+        } else {
+            vmem_swap(i, j);
+        }
+    }
+    vmem_write(r - 1, vi);
+    vmem_write(i, p);
+    return i;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function pushes an unsorted range to the bottom of the deque of
+ *              a thread.
+ *
+ *  @param      w The thread.
+ *
+ *  @param      l address of the left-most element
+ *
+ *  @param      r address of the right-most element
+ *
+ *  @return     FALSE if the deque is full.
+ ****************************************************************************************/
+static int deque_push(struct psort_worker *w, int l, int r) {
+    int ok = FALSE;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->bottom - w->top < PSORT_DEQUE_SIZE) {
+        __atomic_fetch_add(&pending, 1, __ATOMIC_RELAXED);
+        w->tasks[w->bottom % PSORT_DEQUE_SIZE].l = l;
+        w->tasks[w->bottom % PSORT_DEQUE_SIZE].r = r;
+        w->bottom++;
+        ok = TRUE;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function pops the range pushed last from the deque of a thread.
+ *
+ *  @param      w The thread.
+ *
+ *  @param      task Receives the range.
+ *
+ *  @return     FALSE if the deque is empty.
+ ****************************************************************************************/
+static int deque_pop(struct psort_worker *w, struct psort_task *task) {
+    int ok = FALSE;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->bottom != w->top) {
+        w->bottom--;
+        *task = w->tasks[w->bottom % PSORT_DEQUE_SIZE];
+        ok = TRUE;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function steals the oldest range of the deque of another thread.
+ *              The other threads will be tried in a round robin starting after w.
+ *
+ *  @param      w The stealing thread.
+ *
+ *  @param      task Receives the range.
+ *
+ *  @return     FALSE if the deques of all other threads are empty.
+ ****************************************************************************************/
+static int deque_steal(struct psort_worker *w, struct psort_task *task) {
+    int i;
+
+    for (i = 1; i < threads; i++) {
+        struct psort_worker *v = &workers[(w->id + i) % threads];
+        int ok = FALSE;
+        pthread_mutex_lock(&v->lock);
+        if (v->bottom != v->top) {
+            *task = v->tasks[v->top % PSORT_DEQUE_SIZE];
+            v->top++;
+            ok = TRUE;
+        }
+        pthread_mutex_unlock(&v->lock);
+        if (ok) {
+            w->steals++;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sorts a range by quicksort. The larger part of each
+ *              partition will be pushed to the deque of the thread, the smaller one
+ *              will be sorted next. If the deque is full, the smaller part will be
+ *              sorted recursively, so the recursion depth is at most log2 of the length.
+ *
+ *  @param      w The thread; NULL: sort sequentially.
+ *
+ *  @param      l address of the left-most element
+ *
+ *  @param      r address of the right-most element
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void quick_range(struct psort_worker *w, int l, int r) {
+    while (r - l + 1 > PSORT_CUTOFF) {
+        int p = partition(l, r);
+        int sl = l, sr = p - 1;  // smaller part
+        int bl = p + 1, br = r;  // larger part
+        if (sr - sl > br - bl) {
+            sl = p + 1;
+            sr = r;
+            bl = l;
+            br = p - 1;
+        }
+        if (w != NULL && br - bl + 1 > PSORT_CUTOFF && deque_push(w, bl, br)) {
+            l = sl;
+            r = sr;
+        } else {
+            quick_range(w, sl, sr);
+            l = bl;
+            r = br;
+        }
+    }
+    sort_small(l, r);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function is the main function of a thread of pquicksort. It sorts
+ *              ranges of its own deque or stolen ranges until all ranges are sorted.
+ *
+ *  @param      arg The thread (struct psort_worker).
+ *
+ *  @return     NULL
+ ****************************************************************************************/
+static void *quick_worker(void *arg) {
+    struct psort_worker *w = arg;
+    struct psort_task task;
+
+    while (__atomic_load_n(&pending, __ATOMIC_ACQUIRE) > 0) {
+        if (deque_pop(w, &task) || deque_steal(w, &task)) {
+            quick_range(w, task.l, task.r);
+            __atomic_fetch_sub(&pending, 1, __ATOMIC_RELEASE);
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes how many of the first k elements of the merge of
+ *              two sorted runs come from the first run (co-rank, merge path).
+ *
+ *  @param      k Number of merged elements, 0 <= k <= na + nb.
+ *
+ *  @param      a Address of the first run.
+ *
+ *  @param      na Length of the first run.
+ *
+ *  @param      b Address of the second run.
+ *
+ *  @param      nb Length of the second run.
+ *
+ *  @return     Number of elements of the first run.
+ ****************************************************************************************/
+static int corank(int k, int a, int na, int b, int nb) {
+    int lo = (k > nb) ? k - nb : 0;
+    int hi = (k < na) ? k : na;
+
+    while (lo < hi) {
+        int i = lo + (hi - lo) / 2;
+        int j = k - i;
+        if (j > 0 && i < na && vmem_read(b + j - 1) > vmem_read(a + i)) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function merges two sorted ranges.
+ *
+ *  @param      a Address of the first range.
+ *
+ *  @param      a_end Address after the first range.
+ *
+ *  @param      b Address of the second range.
+ *
+ *  @param      b_end Address after the second range.
+ *
+ *  @param      out Address of the output.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void merge(int a, int a_end, int b, int b_end, int out) {
+    int va = (a < a_end) ? vmem_read(a) : 0;
+    int vb = (b < b_end) ? vmem_read(b) : 0;
+
+    while (a < a_end && b < b_end) {
+        if (va <= vb) {
+            vmem_write(out++, va);
+            if (++a < a_end) {
+                va = vmem_read(a);
+            }
+        } else {
+            vmem_write(out++, vb);
+            if (++b < b_end) {
+                vb = vmem_read(b);
+            }
+        }
+    }
+    copy_range(out, a, a_end - a);
+    copy_range(out + (a_end - a), b, b_end - b);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function is the main function of a thread of pmergesort.
+ *
+ *  The thread sorts every threads-th run of PSORT_CUTOFF elements. In each pass it
+ *  produces the elements lo .. hi - 1 of the output, taking its parts of the runs
+ *  by co-rank. The passes alternate between the array and the buffer.
+ *
+ *  @param      arg The thread (struct psort_worker).
+ *
+ *  @return     NULL
+ ****************************************************************************************/
+static void *merge_worker(void *arg) {
+    struct psort_worker *w = arg;
+    int lo = (int) ((long) n * w->id / threads);
+    int hi = (int) ((long) n * (w->id + 1) / threads);
+    int src = 0;
+    int dst = n;
+    int width, k;
+
+    for (k = w->id * PSORT_CUTOFF; k < n; k += threads * PSORT_CUTOFF) {
+        sort_small(k, ((k + PSORT_CUTOFF < n) ? k + PSORT_CUTOFF : n) - 1);
+    }
+    pthread_barrier_wait(&barrier);
+    for (width = PSORT_CUTOFF; width < n; width *= 2) {
+        int s;
+        for (s = (lo / (2 * width)) * 2 * width; s < hi; s += 2 * width) {
+            int m = (s + width < n) ? s + width : n;         // start of the second run
+            int e = (s + 2 * width < n) ? s + 2 * width : n; // end of the second run
+            int a = (s > lo) ? s : lo;                       // output of this thread: a .. b - 1
+            int b = (e < hi) ? e : hi;
+            int i0 = corank(a - s, src + s, m - s, src + m, e - m);
+            int i1 = corank(b - s, src + s, m - s, src + m, e - m);
+            merge(src + s + i0, src + s + i1, src + m + (a - s - i0), src + m + (b - s - i1), dst + a);
+        }
+        pthread_barrier_wait(&barrier);
+        k = src;
+        src = dst;
+        dst = k;
+    }
+    if (src != 0) {
+        copy_range(lo, src + lo, hi - lo);
+    }
+    return NULL;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function finds the bucket of a value by binary search of the
+ *              splitters.
+ *
+ *  @param      v The value.
+ *
+ *  @return     The bucket, 0 .. threads - 1.
+ ****************************************************************************************/
+static int bucket(int v) {
+    int lo = 0;
+    int hi = threads - 1;
+
+    while (lo < hi) {
+        int m = (lo + hi) / 2;
+        if (splitters[m] < v) {
+            lo = m + 1;
+        } else {
+            hi = m;
+        }
+    }
+    return lo;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function is the main function of a thread of samplesort.
+ *
+ *  The thread counts the elements of its chunk per bucket, scatters them into the
+ *  buckets in the buffer after all counts are known, and finally sorts its bucket
+ *  and copies it back into the array.
+ *
+ *  @param      arg The thread (struct psort_worker).
+ *
+ *  @return     NULL
+ ****************************************************************************************/
+static void *sample_worker(void *arg) {
+    struct psort_worker *w = arg;
+    int lo = (int) ((long) n * w->id / threads);
+    int hi = (int) ((long) n * (w->id + 1) / threads);
+    int offset[PSORT_MAXTHREADS];
+    int buf[PSORT_BLOCK];
+    int start = n;
+    int end = n;
+    int pos = n;
+    int b, t, i, k;
+
+    for (b = 0; b < threads; b++) {
+        counts[w->id][b] = 0;
+    }
+    for (i = lo; i < hi; i += PSORT_BLOCK) {
+        int c = (hi - i < PSORT_BLOCK) ? hi - i : PSORT_BLOCK;
+        vmem_read_range(i, buf, c);
+        for (k = 0; k < c; k++) {
+            counts[w->id][bucket(buf[k])]++;
+        }
+    }
+    pthread_barrier_wait(&barrier);
+    // buckets are stored in ascending order, each one by the chunks in ascending order
+    for (b = 0; b < threads; b++) {
+        if (b == w->id) {
+            start = pos;
+        }
+        for (t = 0; t < threads; t++) {
+            if (t == w->id) {
+                offset[b] = pos;
+            }
+            pos += counts[t][b];
+        }
+        if (b == w->id) {
+            end = pos;
+        }
+    }
+    for (i = lo; i < hi; i += PSORT_BLOCK) {
+        int c = (hi - i < PSORT_BLOCK) ? hi - i : PSORT_BLOCK;
+        vmem_read_range(i, buf, c);
+        for (k = 0; k < c; k++) {
+            vmem_write(offset[bucket(buf[k])]++, buf[k]);
+        }
+    }
+    pthread_barrier_wait(&barrier);
+    if (end > start) {
+        quick_range(NULL, start, end - 1);
+        copy_range(start - n, start, end - start);
+    }
+    return NULL;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function runs all threads of a parallel sort and waits for them.
+ *              The deques must have been initialized by init_workers.
+ *
+ *  @param      start Main function of the threads.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void run_workers(void *(*start)(void *)) {
+    int t;
+
+    TEST_AND_EXIT(pthread_barrier_init(&barrier, NULL, threads) != 0, (stderr, "pthread_barrier_init failed\n"));
+    for (t = 0; t < threads; t++) {
+        TEST_AND_EXIT(pthread_create(&workers[t].thread, NULL, start, &workers[t]) != 0, (stderr, "Error creating thread\n"));
+    }
+    for (t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function initializes the threads of a parallel sort.
+ *
+ *  @param      length Length of the array.
+ *
+ *  @param      buffer TRUE: the sort uses the buffer behind the array.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void init_workers(int length, int buffer) {
+    int t;
+
+    TEST_AND_EXIT(length < 0 || (buffer ? 2 * length : length) > VMEM_VIRTMEMSIZE,
+                  (stderr, "psort: array of length %d does not fit into virtual memory\n", length));
+    n = length;
+    pending = 0;
+    for (t = 0; t < threads; t++) {
+        workers[t].id = t;
+        workers[t].top = 0;
+        workers[t].bottom = 0;
+        workers[t].steals = 0;
+        pthread_mutex_init(&workers[t].lock, NULL);
+    }
+}
+
+void psort_quicksort(int length) {
+    unsigned long steals = 0;
+    int t;
+
+    init_workers(length, FALSE);
+    if (length > 1) {
+        deque_push(&workers[0], 0, length - 1);
+        run_workers(quick_worker);
+    }
+    for (t = 0; t < threads; t++) {
+        steals += workers[t].steals;
+        pthread_mutex_destroy(&workers[t].lock);
+    }
+    fprintf(stderr, "Work stealing: %d threads, %lu steals\n", threads, steals);
+}
+
+void psort_mergesort(int length) {
+    int t;
+
+    init_workers(length, TRUE);
+    if (length > 1) {
+        run_workers(merge_worker);
+    }
+    for (t = 0; t < threads; t++) {
+        pthread_mutex_destroy(&workers[t].lock);
+    }
+}
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+    return (x > y) - (x < y);
+}
+
+void psort_samplesort(int length) {
+    int samples[PSORT_MAXTHREADS * PSORT_OVERSAMPLE];
+    int s = threads * PSORT_OVERSAMPLE;
+    int b, k, t;
+
+    init_workers(length, TRUE);
+    if (length > 1) {
+        if (s > length) {
+            s = length;
+        }
+        // equidistant samples, the splitters divide them into equal parts
+        for (k = 0; k < s; k++) {
+            samples[k] = vmem_read((int) ((2L * k + 1) * length / (2 * s)));
+        }
+        qsort(samples, s, sizeof(int), cmp_int);
+        for (b = 0; b < threads - 1; b++) {
+            splitters[b] = samples[(long) (b + 1) * s / threads];
+        }
+        run_workers(sample_worker);
+    }
+    for (t = 0; t < threads; t++) {
+        pthread_mutex_destroy(&workers[t].lock);
+    }
+}
+
+// EOF
@@ -0,0 +1,108 @@
+/**
+ * @file psort.h
+ * @brief Header file of the parallel sort module of vmappl.
+ *
+ * The array to be sorted is located at the virtual memory addresses
+ * 0 .. length - 1. It will be sorted by several threads of vmappl, so page
+ * faults of different threads hit mmanage at the same time:
+ *
+ *   pquicksort  Parallel quicksort. Each thread owns a deque of unsorted ranges.
+ *               A thread partitions a range, pushes the larger part to the bottom
+ *               of its deque and continues with the smaller one. An idle thread
+ *               pops the bottom of its own deque or steals the top (the oldest
+ *               and largest range) of the deque of another thread. The threads
+ *               work on disjoint regions.
+ *   pmergesort  Parallel bottom-up mergesort. Each pass merges pairs of runs; the
+ *               output of the pass is split into equal parts, one per thread, and
+ *               the inputs of each part are found by a binary search (merge path),
+ *               so the threads read overlapping regions.
+ *   samplesort  Parallel sample sort. Splitters are chosen from a sample of the
+ *               array. Each thread counts and scatters the elements of its chunk
+ *               into the buckets, so all threads write to all buckets, then each
+ *               thread sorts one bucket.
+ *
+ * The partitions exchange elements by vmem_swap, so the pages of both elements stay
+ * in memory during the exchange.
+ * pmergesort and samplesort use the addresses length .. 2 * length - 1 as buffer.
+ * Ranges of up to PSORT_CUTOFF elements are sorted in a local buffer.
+ */
+
+#ifndef PSORT_H
+#define PSORT_H
+
+#define PSORT_THREADS     4  //!< Default number of threads
+#define PSORT_MAXTHREADS 64  //!< Max. number of threads
+#define PSORT_CUTOFF     16  //!< Ranges up to this length will be sorted by insertion sort in a local buffer
+#define PSORT_BLOCK      64  //!< Number of ints copied by one vmem_read_range / vmem_write_range
+#define PSORT_DEQUE_SIZE 64  //!< Max. number of ranges in the deque of a thread
+#define PSORT_OVERSAMPLE  8  //!< Sample sort: number of samples per bucket
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans one command line parameter of the parallel sort
+ *              module. See psort_usage for the parameters.
+ *
+ *  @param      arg The parameter.
+ *
+ *  @return     TRUE if arg is a valid parameter of the psort module, otherwise FALSE.
+ ****************************************************************************************/
+int psort_option(const char *arg);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the usage information of the parameters
+ *              scanned by psort_option to stderr.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void psort_usage(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the number of threads of the parallel sorts.
+ *
+ *  @return     The number of threads.
+ ****************************************************************************************/
+int psort_threads(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function lets the partitions of pquicksort and samplesort exchange 
+ *              elements by single writes instead of vmem_swap.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void psort_legacy(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sorts the array by parallel quicksort with work stealing.
+ *              The number of stolen ranges will be printed to stderr.
+ *
+ *  @param      length Length of the array.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void psort_quicksort(int length);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sorts the array by parallel mergesort.
+ *
+ *  @param      length Length of the array, 2 * length <= VMEM_VIRTMEMSIZE.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void psort_mergesort(int length);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sorts the array by parallel sample sort.
+ *
+ *  @param      length Length of the array, 2 * length <= VMEM_VIRTMEMSIZE.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void psort_samplesort(int length);
+
+#endif /* PSORT_H */
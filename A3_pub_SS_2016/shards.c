@@ -0,0 +1,401 @@
+/**
+ * @file shards.c
+ * @brief This module computes sampled LRU miss ratio curves (SHARDS).
+ *        See shards.h for the algorithm and mrc.h for the integration.
+ */
+
+#include <math.h>
+#include "vmem.h"
+#include "shards.h"
+#include "debug.h"
+#include "mytypes.h"
+
+#define SHARDS_NSIZES 4 //!< Number of page sizes
+
+static const int shards_pagesizes[SHARDS_NSIZES] = { 8, 16, 32, 64 };
+
+/**
+ * Time of the last access of a sampled page, used to sort the pages by time
+ */
+struct shards_time {
+    unsigned int last;  //!< time of the last access
+    int slot;           //!< slot of the page in the hash table
+};
+
+/**
+ * State of the sampled curve of one page size. All arrays are allocated by
+ * shards_open, their size depends on smax only.
+ */
+struct shards_sampler {
+    int pagesize;               //!< page size in ints
+    unsigned int threshold;     //!< a page is sampled iff its hash is below threshold
+    int n;                      //!< number of sampled pages
+    int cap;                    //!< size of the hash table, a power of 2 >= 2 * smax
+    int *page;                  //!< hash table (linear probing): sampled page; VOID_IDX: empty slot
+    unsigned int *last;         //!< hash table: time of the last access of the page
+    unsigned int *heap_hash;    //!< max heap of the hash values of the sampled pages
+    int *heap_page;             //!< max heap: page of each hash value
+    int *tree;                  //!< Fenwick tree: 1 at the time of the last access of each page
+    unsigned int tree_size;     //!< number of times of the Fenwick tree
+    unsigned int now;           //!< time of the last sampled access
+    struct shards_time *times;  //!< buffer for the compaction of times
+    double hist[SHARDS_GROUPS][SHARDS_BINS + 2]; //!< sampled accesses per group and distance bin; 
+                                                 //!< bin SHARDS_BINS + 1: larger distances
+    double cold[SHARDS_GROUPS];     //!< sampled first accesses per group
+    double sampled[SHARDS_GROUPS];  //!< sampled accesses per group (rescaled to the current threshold)
+};
+
+/*
+ * static variables
+ */
+static struct shards_sampler samplers[SHARDS_NSIZES]; //!< state of all page sizes
+static int smax = SHARDS_SMAX;                         //!< max. number of sampled pages
+static int step = 1;                                   //!< the result contains multiples of step frames
+static unsigned long accesses = 0;                     //!< number of accesses
+static char *result_name = NULL;                       //!< name of the result file; NULL: not started
+
+static void shards_close(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes the spatial hash of a page (SplitMix64 finalizer).
+ *
+ *  @param      page The page.
+ *
+ *  @return     Hash value, 0 <= value < SHARDS_P
+ ****************************************************************************************/
+static unsigned int page_hash(int page) {
+    unsigned long long z = (unsigned long long) page + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (unsigned int) ((z ^ (z >> 31)) & (SHARDS_P - 1));
+}
+
+static void fenwick_add(struct shards_sampler *s, unsigned int i, int v) {
+    for (; i <= s->tree_size; i += i & -i) {
+        s->tree[i] += v;
+    }
+}
+
+static int fenwick_sum(const struct shards_sampler *s, unsigned int i) {
+    int sum = 0;
+    for (; i > 0; i -= i & -i) {
+        sum += s->tree[i];
+    }
+    return sum;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function searches a page in the hash table.
+ *
+ *  @param      s State of the page size.
+ *
+ *  @param      page The page.
+ *
+ *  @return     Slot of the page or of the empty slot where it has to be inserted.
+ ****************************************************************************************/
+static int table_find(const struct shards_sampler *s, int page) {
+    int i = page_hash(page) & (s->cap - 1);
+    while (s->page[i] != VOID_IDX && s->page[i] != page) {
+        i = (i + 1) & (s->cap - 1);
+    }
+    return i;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function removes the page of a slot from the hash table. Following
+ *              pages of the probe sequence are moved back (no tombstones).
+ *
+ *  @param      s State of the page size.
+ *
+ *  @param      i Slot of the page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void table_remove(struct shards_sampler *s, int i) {
+    int j = i;
+
+    s->page[i] = VOID_IDX;
+    while (1) {
+        int home;
+        j = (j + 1) & (s->cap - 1);
+        if (s->page[j] == VOID_IDX) {
+            return;
+        }
+        home = page_hash(s->page[j]) & (s->cap - 1);
+        // move page j to the gap i if its home slot is not in (i, j]
+        if (((j - home) & (s->cap - 1)) >= ((j - i) & (s->cap - 1))) {
+            s->page[i] = s->page[j];
+            s->last[i] = s->last[j];
+            s->page[j] = VOID_IDX;
+            i = j;
+        }
+    }
+}
+
+static void heap_push(struct shards_sampler *s, unsigned int hash, int page) {
+    int i = s->n;
+    while (i > 0 && s->heap_hash[(i - 1) / 2] < hash) {
+        s->heap_hash[i] = s->heap_hash[(i - 1) / 2];
+        s->heap_page[i] = s->heap_page[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    s->heap_hash[i] = hash;
+    s->heap_page[i] = page;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function removes the largest hash value from the heap.
+ *              s->n must be decremented by the caller afterwards.
+ *
+ *  @param      s State of the page size.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void heap_pop(struct shards_sampler *s) {
+    unsigned int hash = s->heap_hash[s->n - 1];
+    int page = s->heap_page[s->n - 1];
+    int n = s->n - 1;
+    int i = 0;
+
+    while (2 * i + 1 < n) {
+        int c = 2 * i + 1;
+        if (c + 1 < n && s->heap_hash[c + 1] > s->heap_hash[c]) {
+            c++;
+        }
+        if (s->heap_hash[c] <= hash) {
+            break;
+        }
+        s->heap_hash[i] = s->heap_hash[c];
+        s->heap_page[i] = s->heap_page[c];
+        i = c;
+    }
+    s->heap_hash[i] = hash;
+    s->heap_page[i] = page;
+}
+
+static int cmp_time(const void *a, const void *b) {
+    unsigned int x = ((const struct shards_time *) a)->last;
+    unsigned int y = ((const struct shards_time *) b)->last;
+    return (x > y) - (x < y);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function renumbers the times of the last accesses to 1 .. n
+ *              (in the same order) when the Fenwick tree is full.
+ *
+ *  @param      s State of the page size.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void compact(struct shards_sampler *s) {
+    int i, k = 0;
+
+    for (i = 0; i < s->cap; i++) {
+        if (s->page[i] != VOID_IDX) {
+            s->times[k].last = s->last[i];
+            s->times[k].slot = i;
+            k++;
+        }
+    }
+    qsort(s->times, k, sizeof(struct shards_time), cmp_time);
+    memset(s->tree, 0, (s->tree_size + 1) * sizeof(int));
+    for (i = 0; i < k; i++) {
+        s->last[s->times[i].slot] = i + 1;
+        fenwick_add(s, i + 1, 1);
+    }
+    s->now = k;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function lowers the threshold to new_threshold. All pages with a
+ *              larger or equal hash value will be removed, the histogram will be
+ *              rescaled to the new sampling rate.
+ *
+ *  @param      s State of the page size.
+ *
+ *  @param      new_threshold The new threshold.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void lower_threshold(struct shards_sampler *s, unsigned int new_threshold) {
+    double scale = (double) new_threshold / s->threshold;
+    int g, i;
+
+    for (g = 0; g < SHARDS_GROUPS; g++) {
+        for (i = 0; i < SHARDS_BINS + 2; i++) {
+            s->hist[g][i] *= scale;
+        }
+        s->cold[g] *= scale;
+        s->sampled[g] *= scale;
+    }
+    s->threshold = new_threshold;
+    while (s->n > 0 && s->heap_hash[0] >= s->threshold) {
+        int slot = table_find(s, s->heap_page[0]);
+        fenwick_add(s, s->last[slot], -1);
+        table_remove(s, slot);
+        heap_pop(s);
+        s->n--;
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adds an access to the sampled curve of one page size.
+ *
+ *  @param      s State of the page size.
+ *
+ *  @param      page Accessed page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void sampler_access(struct shards_sampler *s, int page) {
+    unsigned int hash = page_hash(page);
+    int g = hash % SHARDS_GROUPS;
+    int slot;
+
+    if (hash >= s->threshold) {
+        return;
+    }
+    slot = table_find(s, page);
+    if (s->page[slot] == VOID_IDX && s->n == smax) {
+        // fixed size: the page with the largest hash (possibly this one) leaves the sample
+        lower_threshold(s, (hash > s->heap_hash[0]) ? hash : s->heap_hash[0]);
+        if (hash >= s->threshold) {
+            return;
+        }
+        slot = table_find(s, page);
+    }
+    if (s->now == s->tree_size) {
+        compact(s);
+    }
+    s->now++;
+    s->sampled[g] += 1;
+    if (s->page[slot] != VOID_IDX) {
+        double rate = (double) s->threshold / SHARDS_P;
+        int d = fenwick_sum(s, s->now - 1) - fenwick_sum(s, s->last[slot]) + 1;
+        double bin = ceil(d / rate / step);
+        s->hist[g][(bin <= SHARDS_BINS) ? (int) bin : SHARDS_BINS + 1] += 1;
+        fenwick_add(s, s->last[slot], -1);
+    } else {
+        s->cold[g] += 1;
+        s->page[slot] = page;
+        heap_push(s, hash, page);
+        s->n++;
+    }
+    fenwick_add(s, s->now, 1);
+    s->last[slot] = s->now;
+}
+
+void shards_open(const char *name, double rate, int max, int frames_step) {
+    int i, j;
+
+    TEST_AND_EXIT(result_name != NULL, (stderr, "shards_open: sampled miss ratio curves already started\n"));
+    result_name = strdup(name);
+    TEST_AND_EXIT_ERRNO(result_name == NULL, "strdup failed");
+    smax = max;
+    step = frames_step;
+    for (i = 0; i < SHARDS_NSIZES; i++) {
+        struct shards_sampler *s = &samplers[i];
+        memset(s, 0, sizeof(*s));
+        s->pagesize = shards_pagesizes[i];
+        s->threshold = (unsigned int) (rate * SHARDS_P);
+        if (s->threshold == 0) {
+            s->threshold = 1;
+        }
+        for (s->cap = 1; s->cap < 2 * smax; s->cap *= 2) {
+        }
+        s->tree_size = 4 * smax;
+        s->page = malloc(s->cap * sizeof(int));
+        s->last = malloc(s->cap * sizeof(unsigned int));
+        s->heap_hash = malloc((smax + 1) * sizeof(unsigned int));
+        s->heap_page = malloc((smax + 1) * sizeof(int));
+        s->tree = calloc(s->tree_size + 1, sizeof(int));
+        s->times = malloc(smax * sizeof(struct shards_time));
+        TEST_AND_EXIT_ERRNO(!s->page || !s->last || !s->heap_hash || !s->heap_page || !s->tree || !s->times,
+                            "malloc failed");
+        for (j = 0; j < s->cap; j++) {
+            s->page[j] = VOID_IDX;
+        }
+    }
+    accesses = 0;
+    atexit(shards_close);
+}
+
+void shards_access(int address) {
+    int i;
+
+    if (address < 0) {
+        return;
+    }
+    accesses++;
+    for (i = 0; i < SHARDS_NSIZES; i++) {
+        sampler_access(&samplers[i], address / samplers[i].pagesize);
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes the sampled miss ratio curves to the result file.
+ *              It will be registered via atexit.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void shards_close(void) {
+    FILE *f = fopen(result_name, "w");
+    double misses[SHARDS_GROUPS];  // sampled misses per group with k * step frames
+    int i, g, k;
+
+    TEST_AND_EXIT_ERRNO(f == NULL, "Error creating miss ratio curve file");
+    fprintf(f, "pagesize,frames,physmem,accesses,rate,sampled,lru,lru_ratio,error\n");
+    for (i = 0; i < SHARDS_NSIZES; i++) {
+        struct shards_sampler *s = &samplers[i];
+        double rate = (double) s->threshold / SHARDS_P;
+        double sampled = 0;
+        int last_bin = 1;
+
+        for (g = 0; g < SHARDS_GROUPS; g++) {
+            misses[g] = s->sampled[g];
+            sampled += s->sampled[g];
+            for (k = 1; k <= SHARDS_BINS; k++) {
+                if (s->hist[g][k] != 0 && k > last_bin) {
+                    last_bin = k;
+                }
+            }
+        }
+        for (k = 1; k <= last_bin; k++) {
+            double total = 0, sum = 0, sum2 = 0, ratio, error;
+            int n = 0;
+            for (g = 0; g < SHARDS_GROUPS; g++) {
+                misses[g] -= s->hist[g][k];
+                total += misses[g];
+                if (s->sampled[g] > 0) {
+                    double r = misses[g] / s->sampled[g];
+                    sum += r;
+                    sum2 += r * r;
+                    n++;
+                }
+            }
+            ratio = (sampled > 0) ? total / sampled : 0;
+            ratio = (ratio < 0) ? 0 : ratio;  // rescaling may leave rounding errors
+            if (s->threshold == SHARDS_P) {
+                error = 0;  // all pages sampled: exact curve
+            } else if (n > 1) {
+                error = SHARDS_T95 * sqrt(fmax(sum2 - sum * sum / n, 0) / (n - 1) / n);
+            } else {
+                error = 1;
+            }
+            fprintf(f, "%d,%d,%d,%lu,%.6f,%.0f,%.0f,%.6f,%.6f\n",
+                    s->pagesize, k * step, k * step * s->pagesize, accesses, rate, sampled,
+                    ratio * accesses, ratio, error);
+        }
+    }
+    fclose(f);
+}
+
+// EOF
@@ -0,0 +1,61 @@
+/**
+ * @file shards.h
+ * @brief Header file of the SHARDS module: sampled LRU miss ratio curves.
+ *
+ * The exact stack algorithm of mrc.c needs memory proportional to the number
+ * of distinct pages. SHARDS (Spatially Hashed Approximate Reuse Distance
+ * Sampling, Waldspurger et al., FAST 2015) processes only the pages whose
+ * hash value is below a threshold T, i.e. a fraction R = T / SHARDS_P of all
+ * pages, together with all their accesses. A stack distance d measured
+ * among the sampled pages corresponds to a distance d / R of the full stream.
+ *
+ * The number of sampled pages is limited to smax (fixed size SHARDS): when a
+ * new page would exceed it, T is lowered to the largest hash value of the
+ * sampled pages, these pages are removed and the histogram is rescaled.
+ * So the memory is constant, independent of the size of the address space.
+ *
+ * The miss ratio is estimated as sampled misses / sampled accesses. Its
+ * variance is dominated by the choice of the sampled pages, so the sampled
+ * pages are split into SHARDS_GROUPS groups by their hash value and each group
+ * estimates the miss ratio on its own. The error column is the half width
+ * of the 95% confidence interval of the mean of the group estimates
+ * (Student's t with SHARDS_GROUPS - 1 degrees of freedom).
+ */
+
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#define SHARDS_P     (1 << 24)  //!< Modulus of the spatial hash; R = T / SHARDS_P
+#define SHARDS_BINS  4096       //!< Number of distance bins of the histogram
+#define SHARDS_SMAX  8192       //!< Default max. number of sampled pages
+#define SHARDS_GROUPS 8         //!< Number of groups of sampled pages for the error estimation
+#define SHARDS_T95   2.365      //!< 97.5% quantile of Student's t distribution, SHARDS_GROUPS - 1 d.o.f.
+
+/**
+ *****************************************************************************************
+ *  @brief      This function starts the computation of sampled miss ratio curves for
+ *              all page sizes. The result will be written to a file by atexit.
+ *
+ *  @param      name Name of the result file (CSV).
+ *
+ *  @param      rate Initial sampling rate R, 0 < rate <= 1.
+ *
+ *  @param      smax Max. number of sampled pages per page size.
+ *
+ *  @param      step Physical memory sizes in the result are multiples of step frames.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void shards_open(const char *name, double rate, int smax, int step);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adds an access to the sampled miss ratio curves.
+ *
+ *  @param      address Accessed virtual memory address, address >= 0.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void shards_access(int address);
+
+#endif /* SHARDS_H */
@@ -0,0 +1,131 @@
+/**
+ * @file stats.c
+ * @brief This module implements the latency histograms. See stats.h.
+ */
+
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+// hist_bucket and hist_upper: 2^HIST_MAX_BITS - 1 is the largest value of the last
+// bucket, larger values are counted in it as well
+_Static_assert(HIST_SUB_BITS < HIST_MAX_BITS && HIST_MAX_BITS < 64, "HIST_MAX_BITS out of range");
+_Static_assert((HIST_MAX_BITS - HIST_SUB_BITS) * HIST_SUB + (HIST_SUB - 1) == HIST_BUCKETS - 1,
+               "bucket of 2^HIST_MAX_BITS - 1 is not the last bucket");
+_Static_assert(((2ULL * HIST_SUB) << (HIST_MAX_BITS - HIST_SUB_BITS - 1)) - 1 == (1ULL << HIST_MAX_BITS) - 1,
+               "largest value of the last bucket is not 2^HIST_MAX_BITS - 1");
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the bucket of a value.
+ *
+ *  @param      v The value.
+ *
+ *  @return     Index of the bucket; HIST_BUCKETS - 1 for values >= 2^HIST_MAX_BITS.
+ ****************************************************************************************/
+static int hist_bucket(unsigned long long v) {
+    int shift;
+
+    if (v < HIST_SUB) {
+        return v;
+    }
+    shift = 63 - __builtin_clzll(v) - HIST_SUB_BITS;
+    if (shift >= HIST_MAX_BITS - HIST_SUB_BITS) {
+        return HIST_BUCKETS - 1;
+    }
+    return (shift + 1) * HIST_SUB + (int) ((v >> shift) - HIST_SUB);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the largest value of a bucket.
+ *
+ *  @param      idx Index of the bucket.
+ *
+ *  @return     The largest value that belongs to bucket idx.
+ ****************************************************************************************/
+static unsigned long long hist_upper(int idx) {
+    int shift = idx / HIST_SUB - 1;
+    unsigned long long sub = idx % HIST_SUB + HIST_SUB;
+
+    if (idx < HIST_SUB) {
+        return idx;
+    }
+    return ((sub + 1) << shift) - 1;
+}
+
+unsigned long long stats_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void stats_init(struct vmem_stats *s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void hist_record(struct hist *h, unsigned long long ns) {
+    unsigned long long max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&h->count[hist_bucket(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, ns, __ATOMIC_RELAXED);
+    while (ns > max && !__atomic_compare_exchange_n(&h->max, &max, ns, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // max has been raised by another writer
+    }
+}
+
+unsigned long long hist_percentile(const struct hist *h, double p) {
+    unsigned long target = (unsigned long) (p * h->total + 0.999999);
+    unsigned long seen = 0;
+    int i;
+
+    if (h->total == 0) {
+        return 0;
+    }
+    if (target == 0) {
+        target = 1;
+    }
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->count[i];
+        if (seen >= target && i == HIST_BUCKETS - 1) {
+            return h->max; // values out of range
+        }
+        if (seen >= target) {
+            return (hist_upper(i) < h->max) ? hist_upper(i) : h->max;
+        }
+    }
+    return h->max;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints one line of stats_dump.
+ *
+ *  @param      f The output stream.
+ *
+ *  @param      name Name of the histogram.
+ *
+ *  @param      h The histogram.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void hist_dump(FILE *f, const char *name, const struct hist *h) {
+    fprintf(f, "%-9s %9lu  mean %9.2f  p50 %9.2f  p99 %9.2f  p999 %9.2f  max %9.2f us\n", name, h->total,
+            h->total ? h->sum / 1000.0 / h->total : 0.0,
+            hist_percentile(h, 0.5) / 1000.0, hist_percentile(h, 0.99) / 1000.0, 
+            hist_percentile(h, 0.999) / 1000.0, h->max / 1000.0);
+}
+
+void stats_dump(FILE *f, const struct vmem_stats *s) {
+    fprintf(f, "Latency   count\n");
+    hist_dump(f, "fault", &s->fault);
+    hist_dump(f, "alloc", &s->alloc);
+    hist_dump(f, "victim", &s->victim);
+    hist_dump(f, "fetch", &s->fetch);
+    hist_dump(f, "exchange", &s->exchange);
+    fflush(f);
+}
+
+// EOF
@@ -0,0 +1,102 @@
+/**
+ * @file stats.h
+ * @brief Header file of the statistics module: latency histograms of the fault path.
+ *
+ * A histogram is log-linear (HDR style): values below 2^HIST_SUB_BITS ns have a 
+ * bucket each, every higher power of two is split into 2^HIST_SUB_BITS buckets
+ * of equal width. So the relative error of a percentile is below 1/16 and a 
+ * histogram has a fixed size, independent of the number of values. 
+ * The histograms are located in shared memory (struct vmem_struct). The fault
+ * round trip is written by all threads of all clients, the others by the threads
+ * of mmanage, so hist_record uses atomic operations.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#define HIST_SUB_BITS 4                  //!< log2 of the number of buckets per power of two
+#define HIST_SUB      (1 << HIST_SUB_BITS) //!< Number of buckets per power of two
+#define HIST_MAX_BITS 40                 //!< Values up to 2^HIST_MAX_BITS ns (about 18 min)
+#define HIST_BUCKETS  ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB) //!< Number of buckets
+
+/**
+ * Latency histogram; all times in ns
+ */
+struct hist {
+    unsigned long count[HIST_BUCKETS]; //!< Number of values per bucket
+    unsigned long total;               //!< Number of values
+    unsigned long long sum;            //!< Sum of all values
+    unsigned long long max;            //!< Largest value
+};
+
+/**
+ * Histograms of the fault path
+ */
+struct vmem_stats {
+    struct hist fault;     //!< vmaccess: page fault round trip (signal / doorbell until mmanage is done)
+    struct hist alloc;     //!< mmanage: allocate_page
+    struct hist victim;    //!< mmanage: selection of the victim by the page replacement algorithm (find_remove_*)
+    struct hist fetch;     //!< mmanage: fetch of a page into a free frame or in place of a clean page
+    struct hist exchange;  //!< mmanage: store of a dirty victim and fetch of the requested page
+};
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the current time of the monotonic clock.
+ *
+ *  @return     Time in ns
+ ****************************************************************************************/
+unsigned long long stats_now(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function clears all histograms.
+ *
+ *  @param      s The histograms.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void stats_init(struct vmem_stats *s);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adds a value to a histogram.
+ *
+ *  @param      h The histogram.
+ *
+ *  @param      ns The value in ns.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void hist_record(struct hist *h, unsigned long long ns);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes a percentile of a histogram. The result is the
+ *              upper bound of the bucket that contains the percentile, but not more 
+ *              than the largest value.
+ *
+ *  @param      h The histogram.
+ *
+ *  @param      p The percentile, 0 < p <= 1 (e.g. 0.99).
+ *
+ *  @return     The percentile in ns; 0 if the histogram is empty.
+ ****************************************************************************************/
+unsigned long long hist_percentile(const struct hist *h, double p);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints count, mean, p50, p99, p999 and max of all
+ *              histograms.
+ *
+ *  @param      f The output stream.
+ *
+ *  @param      s The histograms.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void stats_dump(FILE *f, const struct vmem_stats *s);
+
+#endif /* STATS_H */
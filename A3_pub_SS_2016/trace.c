@@ -0,0 +1,157 @@
+/**
+ * @file trace.c
+ * @brief This module records and reads address traces. See trace.h for the format.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "debug.h"
+#include "mytypes.h"
+#include "vmem.h"
+#include "trace.h"
+
+#define TRACE_BUFSIZE (64 * 1024)  //!< Size of the write buffer
+
+static FILE *tracefile = NULL;                  //!< Trace file written by trace_record
+static unsigned char buf[TRACE_BUFSIZE];        //!< Write buffer
+static size_t buf_len = 0;                      //!< Number of bytes in buf
+static int last_address = 0;                    //!< Address of the last recorded access
+static int last_g_count = 0;                    //!< g_count of the last recorded access
+
+static void flush_buf(void) {
+    TEST_AND_EXIT_ERRNO(fwrite(buf, 1, buf_len, tracefile) != buf_len, "Error writing trace file");
+    buf_len = 0;
+}
+
+static void put_varint(unsigned long long val) {
+    while (val >= 0x80) {
+        buf[buf_len++] = (unsigned char) (val | 0x80);
+        val >>= 7;
+    }
+    buf[buf_len++] = (unsigned char) val;
+}
+
+static unsigned int zigzag(int val) {
+    return ((unsigned int) val << 1) ^ (unsigned int) (val >> 31);
+}
+
+static int unzigzag(unsigned int val) {
+    return (int) (val >> 1) ^ -(int) (val & 1);
+}
+
+void trace_open(const char *name) {
+    struct trace_header hdr = { TRACE_MAGIC, VMEM_PAGESIZE, 0 };
+
+    tracefile = fopen(name, "w");
+    TEST_AND_EXIT_ERRNO(!tracefile, "Error creating trace file");
+    TEST_AND_EXIT_ERRNO(fwrite(&hdr, sizeof(hdr), 1, tracefile) != 1, "Error writing trace file");
+    atexit(trace_close);
+}
+
+void trace_record(int address, int is_write, int g_count) {
+    if (buf_len > TRACE_BUFSIZE - TRACE_MAXREC) {
+        flush_buf();
+    }
+    put_varint(((unsigned long long) zigzag(address - last_address) << 1) | (is_write ? 1 : 0));
+    put_varint(zigzag(g_count - last_g_count));
+    last_address = address;
+    last_g_count = g_count;
+}
+
+void trace_close(void) {
+    if (tracefile != NULL) {
+        flush_buf();
+        TEST_AND_EXIT_ERRNO(fclose(tracefile) == EOF, "Error closing trace file");
+        tracefile = NULL;
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function maps the window of the trace file that starts at 
+ *              tr->win_off. The window overlaps the next one by TRACE_MAXREC bytes,
+ *              so an access never crosses the end of a window.
+ *
+ *  @param      tr State of the reader.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void map_window(struct trace_reader *tr) {
+    if (tr->win != NULL) {
+        munmap(tr->win, tr->win_len);
+        tr->win = NULL;
+    }
+    tr->win_len = tr->size - tr->win_off;
+    if (tr->win_len > TRACE_WINDOW + TRACE_MAXREC) {
+        tr->win_len = TRACE_WINDOW + TRACE_MAXREC;
+    }
+    if (tr->win_len == 0) {
+        return;
+    }
+    tr->win = mmap(NULL, tr->win_len, PROT_READ, MAP_PRIVATE, tr->fd, tr->win_off);
+    TEST_AND_EXIT_ERRNO(tr->win == MAP_FAILED, "Error mapping trace file");
+    madvise(tr->win, tr->win_len, MADV_SEQUENTIAL);
+}
+
+static unsigned long long get_varint(struct trace_reader *tr) {
+    unsigned long long val = 0;
+    int shift = 0;
+    unsigned char c;
+
+    do {
+        TEST_AND_EXIT(tr->pos >= tr->win_len || shift > 35, (stderr, "Corrupt trace file\n"));
+        c = tr->win[tr->pos++];
+        val |= (unsigned long long) (c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return val;
+}
+
+void trace_reader_open(struct trace_reader *tr, const char *name) {
+    struct stat st;
+    struct trace_header hdr;
+
+    memset(tr, 0, sizeof(*tr));
+    tr->fd = open(name, O_RDONLY);
+    TEST_AND_EXIT_ERRNO(tr->fd == -1, "Error opening trace file");
+    TEST_AND_EXIT_ERRNO(fstat(tr->fd, &st) == -1, "Error reading trace file");
+    TEST_AND_EXIT(read(tr->fd, &hdr, sizeof(hdr)) != sizeof(hdr) || memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) != 0,
+                  (stderr, "%s is not a trace file\n", name));
+    tr->size = st.st_size;
+    tr->win_off = 0;
+    tr->pos = sizeof(hdr);
+    map_window(tr);
+}
+
+int trace_next(struct trace_reader *tr, int *address, int *is_write, int *g_count) {
+    unsigned long long val;
+
+    if (tr->pos >= TRACE_WINDOW && tr->win_off + tr->pos < tr->size) {
+        tr->win_off += TRACE_WINDOW;
+        tr->pos -= TRACE_WINDOW;
+        map_window(tr);
+    }
+    if (tr->win_off + tr->pos >= tr->size) {
+        return FALSE;
+    }
+    val = get_varint(tr);
+    tr->address += unzigzag((unsigned int) (val >> 1));
+    tr->g_count += unzigzag((unsigned int) get_varint(tr));
+    *address = tr->address;
+    *is_write = val & 1;
+    *g_count = tr->g_count;
+    return TRUE;
+}
+
+void trace_reader_close(struct trace_reader *tr) {
+    if (tr->win != NULL) {
+        munmap(tr->win, tr->win_len);
+    }
+    close(tr->fd);
+}
+
+// EOF
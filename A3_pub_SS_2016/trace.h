@@ -0,0 +1,122 @@
+/**
+ * @file trace.h
+ * @brief Header file of the address trace module.
+ *
+ * An address trace contains all accesses of an application to virtual memory.
+ * After a header of type struct trace_header, each access is stored as two
+ * varints (7 bit groups, least significant group first):
+ *   - zigzag encoded address delta, shifted left by one; bit 0 is 1 for a write
+ *   - zigzag encoded delta of the global counter g_count
+ * Sequential accesses therefore need two bytes each.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define TRACE_ENV     "VMEM_TRACE"     //!< Environment variable that defines the trace file of vmaccess
+#define TRACE_MAGIC   "VMTRACE1"       //!< First 8 bytes of a trace file
+#define TRACE_WINDOW  (64 << 20)       //!< Size of the part of a trace file mapped at a time by the reader
+#define TRACE_MAXREC  16               //!< Upper bound of the size of one encoded access
+
+/**
+ * Header of a trace file
+ */
+struct trace_header {
+    char magic[8];          //!< TRACE_MAGIC
+    int32_t pagesize;       //!< VMEM_PAGESIZE of the recording application (for information only)
+    int32_t reserved;       //!< 0
+};
+
+/**
+ * State of a trace reader
+ */
+struct trace_reader {
+    int fd;                 //!< file descriptor of the trace file
+    off_t size;             //!< size of the trace file
+    off_t win_off;          //!< file offset of the mapped window
+    size_t win_len;         //!< length of the mapped window
+    unsigned char *win;     //!< mapped window
+    size_t pos;             //!< read position in the window
+    int address;            //!< address of the last access
+    int g_count;            //!< g_count of the last access
+};
+
+/**
+ *****************************************************************************************
+ *  @brief      This function creates a trace file. All following calls of trace_record
+ *              will be written to this file. The file will be closed by atexit.
+ *
+ *  @param      name Name of the trace file.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_open(const char *name);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function appends an access to the trace file.
+ *
+ *  @param      address Virtual address of the access.
+ *
+ *  @param      is_write TRUE for a write access, FALSE for a read access.
+ *
+ *  @param      g_count Global counter of the access (before it has been incremented).
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_record(int address, int is_write, int g_count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function flushes and closes the trace file.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_close(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function opens a trace file for reading.
+ *
+ *  The file will be mapped into memory window by window (TRACE_WINDOW), so traces
+ *  larger than main memory or address space can be streamed.
+ *
+ *  @param      tr State of the reader.
+ *
+ *  @param      name Name of the trace file.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_reader_open(struct trace_reader *tr, const char *name);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function reads the next access out of a trace file.
+ *
+ *  @param      tr State of the reader.
+ *
+ *  @param      address Receives the virtual address of the access.
+ *
+ *  @param      is_write Receives TRUE for a write access, FALSE for a read access.
+ *
+ *  @param      g_count Receives the global counter of the access.
+ *
+ *  @return     TRUE if an access has been read, FALSE at the end of the trace.
+ ****************************************************************************************/
+int trace_next(struct trace_reader *tr, int *address, int *is_write, int *g_count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function closes a trace file opened by trace_reader_open.
+ *
+ *  @param      tr State of the reader.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_reader_close(struct trace_reader *tr);
+
+#endif /* TRACE_H */
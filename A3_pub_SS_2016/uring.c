@@ -0,0 +1,121 @@
+/**
+ * @file uring.c
+ * @brief This module implements a minimal io_uring wrapper. See uring.h.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "debug.h"
+#include "mytypes.h"
+#include "uring.h"
+
+int uring_init(struct uring *ring, unsigned entries) {
+    struct io_uring_params p;
+    unsigned char *sq;
+    unsigned char *cq;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&p, 0, sizeof(p));
+    ring->fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd == -1) {
+        return -1;
+    }
+
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sq_len = ring->cq_len = (ring->sq_len > ring->cq_len) ? ring->sq_len : ring->cq_len;
+    }
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(ring->fd);
+        ring->fd = -1;
+        return -1;
+    }
+    ring->cq_ptr = ring->sq_ptr;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+                            ring->fd, IORING_OFF_CQ_RING);
+        TEST_AND_EXIT_ERRNO(ring->cq_ptr == MAP_FAILED, "mmap of io_uring completion queue failed");
+    }
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+                      ring->fd, IORING_OFF_SQES);
+    TEST_AND_EXIT_ERRNO(ring->sqes == MAP_FAILED, "mmap of io_uring submission entries failed");
+
+    sq = ring->sq_ptr;
+    cq = ring->cq_ptr;
+    ring->sq_head = (unsigned *) (sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + p.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    return 0;
+}
+
+void uring_queue(struct uring *ring, int opcode, int fd, void *buf, unsigned len, 
+                 unsigned long long offset, unsigned long long user_data) {
+    unsigned tail = *ring->sq_tail;
+    unsigned idx = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+    TEST_AND_EXIT(tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) > *ring->sq_mask, 
+                  (stderr, "io_uring submission queue full\n"));
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long) buf;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->queued++;
+}
+
+void uring_submit(struct uring *ring, unsigned wait) {
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, ring->fd, ring->queued, wait, 
+                      wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret == -1 && errno == EINTR);
+    TEST_AND_EXIT_ERRNO(ret == -1, "io_uring_enter failed");
+    ring->queued -= ret;
+}
+
+int uring_complete(struct uring *ring, unsigned long long *user_data, int *res) {
+    unsigned head = *ring->cq_head;
+    struct io_uring_cqe *cqe;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return FALSE;
+    }
+    cqe = &ring->cqes[head & *ring->cq_mask];
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return TRUE;
+}
+
+void uring_exit(struct uring *ring) {
+    if (ring->fd == -1) {
+        return;
+    }
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+// EOF
@@ -0,0 +1,111 @@
+/**
+ * @file uring.h
+ * @brief Header file of a minimal io_uring wrapper.
+ *
+ * liburing is not required: the ring is set up and driven by the raw system
+ * calls io_uring_setup and io_uring_enter. Only what the pagefile module needs
+ * is supported: read and write requests on one file, submitted in batches, and
+ * the completions of these requests.
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+
+/**
+ * State of a ring: the mapped submission and completion queues.
+ */
+struct uring {
+    int fd;                     //!< File descriptor of the ring; -1: no ring
+    unsigned *sq_head;          //!< Submission queue head (consumed by the kernel)
+    unsigned *sq_tail;          //!< Submission queue tail
+    unsigned *sq_mask;          //!< Submission queue index mask
+    unsigned *sq_array;         //!< Submission queue: indices into sqes
+    struct io_uring_sqe *sqes;  //!< Submission queue entries
+    unsigned *cq_head;          //!< Completion queue head
+    unsigned *cq_tail;          //!< Completion queue tail (produced by the kernel)
+    unsigned *cq_mask;          //!< Completion queue index mask
+    struct io_uring_cqe *cqes;  //!< Completion queue entries
+    unsigned queued;            //!< Number of requests queued but not submitted yet
+    void *sq_ptr;               //!< Mapping of the submission queue ring
+    size_t sq_len;              //!< Size of the mapping sq_ptr
+    void *cq_ptr;               //!< Mapping of the completion queue ring; may be sq_ptr
+    size_t cq_len;              //!< Size of the mapping cq_ptr
+    size_t sqes_len;            //!< Size of the mapping sqes
+};
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sets up a ring.
+ *
+ *  @param      ring The ring to be initialized.
+ *
+ *  @param      entries Size of the submission queue.
+ *
+ *  @return     0 on success, otherwise -1 (errno will be set, e.g. ENOSYS if the 
+ *              kernel does not support io_uring).
+ ****************************************************************************************/
+int uring_init(struct uring *ring, unsigned entries);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function queues a read or write request. The request will be
+ *              submitted by the next call of uring_submit.
+ *
+ *  @param      ring The ring.
+ *
+ *  @param      opcode IORING_OP_READ or IORING_OP_WRITE.
+ *
+ *  @param      fd File descriptor of the file.
+ *
+ *  @param      buf Buffer to read into / write from.
+ *
+ *  @param      len Number of bytes.
+ *
+ *  @param      offset Position in the file.
+ *
+ *  @param      user_data Will be returned with the completion of the request.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void uring_queue(struct uring *ring, int opcode, int fd, void *buf, unsigned len, 
+                 unsigned long long offset, unsigned long long user_data);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function submits all queued requests and waits for completions.
+ *
+ *  @param      ring The ring.
+ *
+ *  @param      wait Number of completions to wait for; 0: don't wait.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void uring_submit(struct uring *ring, unsigned wait);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function takes the next completion out of the completion queue.
+ *
+ *  @param      ring The ring.
+ *
+ *  @param      user_data Receives user_data of the completed request.
+ *
+ *  @param      res Receives the result of the request (bytes transfered or -errno).
+ *
+ *  @return     TRUE if a completion has been taken, FALSE if the queue is empty.
+ ****************************************************************************************/
+int uring_complete(struct uring *ring, unsigned long long *user_data, int *res);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function unmaps and closes a ring.
+ *
+ *  @param      ring The ring.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void uring_exit(struct uring *ring);
+
+#endif /* URING_H */
@@ -3,47 +3,368 @@
  * @author Prof. Dr. Wolfgang Fohl, HAW Hamburg
  * @date 2010
  * @brief The access functions to virtual memory.
+ *
+ * Each process using vmaccess is a client of mmanage with an address space
+ * of its own (ASID). It claims a slot of vmem->clients when it attaches.
+ * The clients share the frames, so mmanage may replace a page of a client 
+ * while this client is running. A client therefore sets vmem_thread.inside 
+ * while it accesses a frame (frames_enter, frames_leave) and validates its 
+ * translation after it has entered. mmanage invalidates the page first and 
+ * waits for the owner to leave before it reuses the frame. The hit path uses
+ * no memory barrier: the manager (mmanage or the in-process simulation) forces
+ * one on the CPU of the client via membarrier.
+ *
+ * The access functions may be called by several threads of a client. Each thread
+ * claims a slot of vmem->threads on its first access (thread_attach): it posts its
+ * page faults and marks its accesses there. The translation cache, the access 
+ * counter and the hits are kept per thread, so the hit path of a thread writes
+ * no cache line that is written by another thread, except for the aging reference
+ * bits (they are stored only if they are not set). Hits will be added to the 
+ * counter of the client in batches of VMEM_HITS_BATCH. Traces and miss ratio 
+ * curves record the accesses of all threads in the order they have been made.
+ *
+ * The LRU list is shared by all threads, so the frames accessed by a thread are
+ * collected per thread and moved to the tail of the list in batches of 
+ * VMEM_LRU_BATCH with one acquisition of its lock (lru_flush). A thread flushes
+ * its batch before its page faults, so the list is exact for a single thread.
+ * With several threads the last accesses of the other threads may be missing
+ * when a victim is selected.
  */
 
 #include "vmem.h"
+#include "vmaccess.h"
 #include "debug.h"
+#include "doorbell.h"
+#include "mmcore.h"
+#include "instance.h"
+#include "trace.h"
+#include "mrc.h"
+#include "lru.h"
+#include "aging.h"
+#include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
+
+#define VMEM_HITS_BATCH 1024 //!< Hits of a thread will be added to vmem_client.hits in batches of this size
+#define VMEM_LRU_BATCH 64    //!< LRU: frames accessed by a thread will be moved in the list in batches of this size
+
+/**
+ * Entry of the translation cache of vmaccess
+ */
+struct tlb_entry {
+	int page;                  //!< cached page; VOID_IDX: unused entry
+	int frame;                 //!< frame that stored page when the entry has been filled
+	unsigned int gen;          //!< vmem->pt.framegen[frame] when the entry has been filled
+};
 
+/**
+ * Access to a frame that has not been applied to the LRU list yet
+ */
+struct lru_access {
+	int frame;                 //!< accessed frame
+	unsigned int gen;          //!< vmem->pt.framegen[frame] at the access
+};
 
 /*
  * static variables
  */
 
 static struct vmem_struct *vmem = NULL; //!< Reference to virtual memory
-static sem_t *local_sem = NULL;
+static int asid = 0;                    //!< ASID of this client: index of its slot in vmem->clients
+static struct vmem_client *me = NULL;   //!< Slot of this client
+static struct pt_entry *pt = NULL;      //!< Page table of the address space of this client
+static int fenced = FALSE;              //!< TRUE: membarrier not available or not registered, frames_enter needs a barrier
+static unsigned long hits_attach = 0;   //!< me->hits when this client attached
+static unsigned long faults_attach = 0; //!< me->faults when this client attached
+static int inproc = FALSE;              //!< TRUE: page faults will be handled by mmcore in this process
+static struct vmem_struct inproc_vmem;  //!< Virtual memory of the in-process simulation
+static int tracing = FALSE;             //!< TRUE: all accesses will be recorded by trace_record
+static int mrc = FALSE;                 //!< TRUE: all accesses will be passed to mrc_access
+static pthread_once_t init_once = PTHREAD_ONCE_INIT; //!< vmem_init runs once per process
+static pthread_key_t thread_key;        //!< Calls thread_detach when a thread with a slot terminates
+static pthread_mutex_t record_lock = PTHREAD_MUTEX_INITIALIZER; //!< Serializes trace_record and mrc_access
+static unsigned long tlb_hits_total = 0;   //!< tlb_hits of all detached threads
+static unsigned long tlb_misses_total = 0; //!< tlb_misses of all detached threads
+
+/*
+ * thread local variables
+ */
+
+static __thread struct vmem_thread *self = NULL;     //!< Slot of the calling thread; NULL: not attached yet
+static __thread sem_t *local_sem = NULL;             //!< Semaphore of the slot of the calling thread posted by mmanage
+static __thread int spin = 0;                        //!< Current adaptive number of polls of doorbell pf_done
+static __thread unsigned long hits = 0;              //!< Hits of the calling thread not yet added to me->hits
+static __thread struct tlb_entry tlb[VMEM_TLB_SIZE]; //!< Direct mapped translation cache (page -> frame)
+static __thread unsigned long tlb_hits = 0;          //!< Number of translations served by tlb
+static __thread unsigned long tlb_misses = 0;        //!< Number of translations that required the page table
+static __thread struct lru_access lru_batch[VMEM_LRU_BATCH]; //!< LRU: accesses of the calling thread in order
+static __thread int lru_pending = 0;                 //!< LRU: number of entries of lru_batch
+
+/**
+ *****************************************************************************************
+ *  @brief      This function invalidates all entries of the translation cache of the
+ *              calling thread.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void tlb_init(void) {
+	int i;
+	for(i = 0; i < VMEM_TLB_SIZE; i++){
+		tlb[i].page = VOID_IDX;
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves the frames accessed by the calling thread to the
+ *              tail of the LRU list in the order of the accesses. Frames that have 
+ *              been reused since the access will be skipped.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void lru_flush(void) {
+	int i;
+
+	if(lru_pending == 0){
+		return;
+	}
+	lru_lock(&vmem->pt);
+	for(i = 0; i < lru_pending; i++){
+		if(__atomic_load_n(&vmem->pt.framegen[lru_batch[i].frame], __ATOMIC_RELAXED) == lru_batch[i].gen){
+			lru_touch(&vmem->pt, lru_batch[i].frame);
+		}
+	}
+	lru_unlock(&vmem->pt);
+	lru_pending = 0;
+}
+
+void vmem_mrc(const char *name) {
+	mrc_open(name);
+	mrc = TRUE;
+}
+
+const struct vmem_stats *vmem_get_stats(void) {
+	return (vmem != NULL) ? &vmem->stats : NULL;
+}
+
+void vmem_trace(const char *name) {
+	trace_open(name);
+	tracing = TRUE;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function claims a free slot of vmem->clients. If all slots are in
+ *              use, the slot of a terminated client will be taken over. The address 
+ *              space of the slot (pages and pagefile) is used as it is.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void client_attach(void) {
+	pid_t self = getpid();
+	pid_t pid = 0;
+	int i = 0;
+
+	for(i = 0; i < VMEM_MAXCLIENTS && me == NULL; i++){
+		pid = 0;
+		if(__atomic_compare_exchange_n(&vmem->clients[i].pid, &pid, self, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)){
+			__atomic_fetch_add(&vmem->adm.nclients, 1, __ATOMIC_RELAXED);
+			me = &vmem->clients[i];
+			asid = i;
+		}
+	}
+	// all slots in use: take over the slot of a terminated client (it is still counted)
+	for(i = 0; i < VMEM_MAXCLIENTS && me == NULL; i++){
+		pid = __atomic_load_n(&vmem->clients[i].pid, __ATOMIC_RELAXED);
+		if(pid != 0 && kill(pid, 0) == -1 && errno == ESRCH && 
+		   __atomic_compare_exchange_n(&vmem->clients[i].pid, &pid, self, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)){
+			me = &vmem->clients[i];
+			asid = i;
+		}
+	}
+	TEST_AND_EXIT(me == NULL, (stderr, "vmaccess: all %d clients of mmanage are running\n", VMEM_MAXCLIENTS));
+	pt = vmem->pt.entries[asid];
+	hits_attach = me->hits;
+	faults_attach = me->faults;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function releases the slot of this client and prints its hits and 
+ *              page faults to stderr. 
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void client_detach(void) {
+	fprintf(stderr, "Client %d: %lu hits, %lu page faults\n", asid, me->hits - hits_attach, me->faults - faults_attach);
+	__atomic_fetch_sub(&vmem->adm.nclients, 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&me->pid, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function releases the slot of a thread. The hits and the statistic
+ *              of the translation cache of the thread will be added to the totals.
+ *              It will be called by the thread that terminates (see thread_key).
+ *
+ *  @param      arg The slot of the thread.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void thread_detach(void *arg) {
+	struct vmem_thread *t = arg;
+
+	lru_flush();
+	__atomic_fetch_add(&me->hits, hits, __ATOMIC_RELAXED);
+	hits = 0;
+	__atomic_fetch_add(&tlb_hits_total, tlb_hits, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&tlb_misses_total, tlb_misses, __ATOMIC_RELAXED);
+	if(local_sem != NULL){
+		sem_close(local_sem);
+		local_sem = NULL;
+	}
+	__atomic_fetch_sub(&me->nthreads, 1, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&t->pid, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function detaches the calling thread and the client and prints the 
+ *              statistic of the translation caches to stderr. It will be registered 
+ *              via atexit.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void process_detach(void) {
+	if(self != NULL){
+		thread_detach(self); // pthread_key destructors don't run on exit
+		self = NULL;
+	}
+	fprintf(stderr, "TLB: %lu hits, %lu misses\n", tlb_hits_total, tlb_misses_total);
+	if(!inproc){
+		client_detach();
+	}
+}
 
 /**
  *****************************************************************************************
  *  @brief      This function setup the connection to virtual memory.
  *              The virtual memory has to be created by mmanage.c module.
+ *              With in-process simulation the virtual memory exists already.
+ *              It will be called once by the first thread that accesses the virtual
+ *              memory (see init_once).
  *
  *  @return     void
  ****************************************************************************************/
 static void vmem_init(void) {
 	void* shmdata = NULL;
-	key_t key = ftok(SHMKEY,SHMPROCID);
-	int shmid = shmget(key,SHMSIZE,IPC_CREAT|SHM_R|SHM_W);
-	if(shmid == -1){
-		printf("Fehler bei shm erstellung");
+	int waited = 0;
+	int shmid;
+
+	if(!inproc){
+		instance_init(NULL);
+		key_t key = instance_shm_key();
+		// mmanage may still be starting: wait for the shared memory and for vmem->adm.ready
+		while((shmid = shmget(key,SHMSIZE,SHM_R|SHM_W)) == -1){
+			TEST_AND_EXIT_ERRNO(errno != ENOENT || waited++ >= VMEM_ATTACH_TIMEOUT, "Fehler bei shm erstellung");
+			usleep(1000);
+		}
+		shmdata = shmat(shmid,NULL,0);
+		TEST_AND_EXIT_ERRNO(shmdata == (void*)-1, "Fehler bei shmd");
+
+		vmem = (struct vmem_struct*)shmdata;
+		while(!__atomic_load_n(&vmem->adm.ready, __ATOMIC_ACQUIRE)){
+			TEST_AND_EXIT(waited++ >= VMEM_ATTACH_TIMEOUT, (stderr, "mmanage not ready\n"));
+			usleep(1000);
+		}
+		client_attach();
+	}
+	// the manager forces the barriers of frames_enter; without membarrier the client executes them
+	fenced = !vmem->adm.membarrier || 
+	         syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_GLOBAL_EXPEDITED, 0, 0) == -1;
+	TEST_AND_EXIT(pthread_key_create(&thread_key, thread_detach) != 0, (stderr, "pthread_key_create failed\n"));
+	atexit(process_detach);
+	if(!tracing && getenv(TRACE_ENV) != NULL){
+		vmem_trace(getenv(TRACE_ENV));
 	}
-	shmdata = shmat(shmid,NULL,0);
-	if(shmdata == (void*)-1){
-		printf("Fehler bei shmd");
+	if(!mrc && getenv(MRC_ENV) != NULL){
+		vmem_mrc(getenv(MRC_ENV));
 	}
+}
 
-	vmem = (struct vmem_struct*)shmdata;
-	local_sem = sem_open(NAMED_SEM,0);
+/**
+ *****************************************************************************************
+ *  @brief      This function claims a free slot of vmem->threads for the calling thread.
+ *              If all slots are in use, the slot of a thread of a terminated client
+ *              will be taken over. The virtual memory will be setup by the first
+ *              thread of the process.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void thread_attach(void) {
+	char sem_name[NAME_MAX];
+	pid_t pid = getpid();
+	pid_t old = 0;
+	int slot = VOID_IDX;
+	int i = 0;
+
+	pthread_once(&init_once, vmem_init);
+	for(i = 0; i < VMEM_MAXTHREADS && slot == VOID_IDX; i++){
+		old = 0;
+		if(__atomic_compare_exchange_n(&vmem->threads[i].pid, &old, pid, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)){
+			slot = i;
+		}
+	}
+	for(i = 0; i < VMEM_MAXTHREADS && slot == VOID_IDX; i++){
+		old = __atomic_load_n(&vmem->threads[i].pid, __ATOMIC_RELAXED);
+		if(old != 0 && old != pid && kill(old, 0) == -1 && errno == ESRCH &&
+		   __atomic_compare_exchange_n(&vmem->threads[i].pid, &old, pid, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)){
+			slot = i;
+		}
+	}
+	TEST_AND_EXIT(slot == VOID_IDX, (stderr, "vmaccess: all %d thread slots of mmanage are in use\n", VMEM_MAXTHREADS));
+	self = &vmem->threads[slot];
+	self->inside = FALSE;
+	self->pf_pending = FALSE;
+	self->pf_done = DOORBELL_IDLE;
+	self->g_count = 0;
+	__atomic_store_n(&self->asid, asid, __ATOMIC_RELAXED);
+	// mmanage reads the number of threads after it has invalidated a frame (see transfer_page)
+	__atomic_fetch_add(&me->nthreads, 1, __ATOMIC_SEQ_CST);
+	if(!inproc){
+		local_sem = sem_open(instance_client_name(NAMED_SEM, slot, sem_name, sizeof(sem_name)),0);
+		TEST_AND_EXIT_ERRNO(local_sem == SEM_FAILED, "Fehler bei semaphore");
+		while(sem_trywait(local_sem) == 0){
+			// answer to a terminated thread of this slot
+		}
+	}
+	spin = vmem->adm.spin_max;
+	tlb_init();
+	pthread_setspecific(thread_key, self);
+}
+
+void vmem_init_inproc(int page_rep_algo) {
+	TEST_AND_EXIT(vmem != NULL, (stderr, "vmem_init_inproc: virtual memory already in use\n"));
+	instance_init(NULL);
+	vmem = &inproc_vmem;
+	inproc = TRUE;
+	vmem->adm.page_rep_algo = page_rep_algo;
+	mmcore_init(vmem);
+	atexit(mmcore_cleanup);
+	me = &vmem->clients[asid];
+	me->pid = getpid();
+	vmem->adm.nclients = 1;
+	pt = vmem->pt.entries[asid];
+	pthread_once(&init_once, vmem_init);
 }
 
 /**
  *****************************************************************************************
  *  @brief      This function does aging for aging page replacement algorithm.
- *              It will be called periodic based on g_count.
+ *              It will be called periodic based on g_count. The step is done by 
+ *              aging_step with vmem->pt.aging_lock.
  *              This function must be used only when aging page replacement algorithm is activ.
  *              Otherwise update_age_reset_ref may interfere with other page replacement 
  *              alogrithms that base on PTF_REF bit.
@@ -51,91 +372,582 @@ static void vmem_init(void) {
  *  @return     void
  ****************************************************************************************/
 static void update_age_reset_ref(void) {
-	if((vmem->adm.g_count % UPDATE_AGE_COUNT) == 0){
-		int i = 0;
-		for(i = 0 ; i <VMEM_NFRAMES; i++ ){
-			int page_number = vmem->pt.framepage[i];
-			if(page_number != VOID_IDX){
-			vmem->pt.entries[page_number].age;
-			int r = vmem->pt.entries[page_number].flags & PTF_REF;
-			vmem->pt.entries[page_number].age = vmem->pt.entries[page_number].age/2; //right shift.
-			if(r == PTF_REF){
-				vmem->pt.entries[page_number].age = vmem->pt.entries[page_number].age|(~CHAR_MAX);
-				vmem->pt.entries[page_number].flags  = vmem->pt.entries[page_number].flags ^ PTF_REF;
-			}}
-		 }
+	if((self->g_count % UPDATE_AGE_COUNT) == 0){
+		// unused frames have age 0 and no reference bit, so they can be aged as well
+		aging_step(&vmem->pt.aging_lock, vmem->pt.frame_age, vmem->pt.frame_ref, VMEM_NFRAMES);
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function marks the begin of an access to a frame. The translation
+ *              must be validated afterwards. 
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void frames_enter(void) {
+	__atomic_store_n(&self->inside, TRUE, __ATOMIC_RELAXED);
+	if(fenced){
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	} else {
+		__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function marks the end of an access to a frame.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void frames_leave(void) {
+	__atomic_store_n(&self->inside, FALSE, __ATOMIC_RELEASE);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function looks up the frame of a page in the page table together
+ *              with the generation of the frame.
+ *
+ *  mmanage invalidates the page table entry before it increments the generation of 
+ *  the frame. The entry will be read again after the generation, so a generation 
+ *  that is newer than the entry cannot be returned.
+ *
+ *  @param      page_index The page.
+ *
+ *  @param      gen Receives the generation of the frame.
+ * 
+ *  @return     The frame of the page; VOID_IDX: the page is not in memory
+ ****************************************************************************************/
+static int lookup_frame(int page_index, unsigned int *gen) {
+	int frame;
+	do {
+		frame = __atomic_load_n(&pt[page_index].frame, __ATOMIC_ACQUIRE);
+		if(frame == VOID_IDX){
+			return VOID_IDX;
 		}
+		*gen = __atomic_load_n(&vmem->pt.framegen[frame], __ATOMIC_ACQUIRE);
+	} while(__atomic_load_n(&pt[page_index].frame, __ATOMIC_ACQUIRE) != frame);
+	return frame;
 }
 
 /**
  *****************************************************************************************
- *  @brief      This function puts a page into memory (if required).
- *              It must be called by vmem_read and vmem_write
+ *  @brief      This function lets mmanage put a page into memory.
+ *              It must be called by vmem_translate between frames_enter and frames_leave.
  *
- *  @param      address The page that stores the contents of this address will be put in (if required).
+ *  The page fault will be posted in the slot of the calling thread and signaled to 
+ *  mmanage the way mmanage has been started with (see vmem->adm.fault_notify). The function returns when mmanage has 
+ *  loaded the page. In-process simulation calls the memory manager core directly.
+ *  The time until the page has been loaded will be recorded in vmem->stats.fault.
+ *  Another thread may have replaced the page again when this function returns.
+ *
+ *  @param      page_index The page that should be put into memory.
  * 
- *  @return     The int value read from virtual memory.
+ *  @return     void
  ****************************************************************************************/
-static void vmem_put_page_into_mem(int address) {
+static void vmem_page_fault(int page_index) {
+	lru_flush(); // the victim will be selected by the accesses so far
+	frames_leave(); // mmanage may wait for this thread
+	unsigned long long start = stats_now();
+	if(inproc){
+		allocate_page(asid, page_index, self->g_count);
+	} else {
+		self->req_pageno = page_index;
+		__atomic_store_n(&self->pf_pending, TRUE, __ATOMIC_RELEASE);
+		if(vmem->adm.fault_notify == VMEM_NOTIFY_FUTEX){
+			doorbell_ring(&vmem->adm.pf_request);
+			doorbell_wait(&self->pf_done, &spin, vmem->adm.spin_max);
+		} else {
+			kill(vmem->adm.mmanage_pid,SIGUSR1);
+			sem_wait(local_sem);
+		}
+	}
+	hist_record(&vmem->stats.fault, stats_now() - start);
+	frames_enter();
 }
 
-int vmem_read(int address) {
-	if(vmem == NULL){
-		vmem_init();
+/**
+ *****************************************************************************************
+ *  @brief      This function sets page table flags of a page.
+ *
+ *  The background cleaner of mmanage clears PTF_DIRTY concurrently, so the flags
+ *  will be changed by an atomic operation. It will be skipped if all flags are 
+ *  set already. 
+ *
+ *  @param      page_index Page whose flags should be set.
+ *
+ *  @param      flags The flags that should be set. Use mark_dirty for PTF_DIRTY.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void set_flags(int page_index, int flags) {
+	int *f = &pt[page_index].flags;
+	if((__atomic_load_n(f, __ATOMIC_RELAXED) & flags) != flags){
+		__atomic_fetch_or(f, flags, __ATOMIC_RELAXED);
 	}
+}
 
+/**
+ *****************************************************************************************
+ *  @brief      This function marks a page as modified. It must be called after the
+ *              data has been stored.
+ *
+ *  If the cleaner writes the page back concurrently, it either sees PTF_DIRTY
+ *  together with the new data or it has cleared PTF_DIRTY before and the page
+ *  will be dirty again. The atomic operation is never skipped: a stale PTF_DIRTY
+ *  could be cleared by the cleaner before the store is visible to it.
+ *  vmem->counters.dirty will be incremented if the page has been clean.
+ *
+ *  @param      page_index Page that has been written.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void mark_dirty(int page_index) {
+	if(!(__atomic_fetch_or(&pt[page_index].flags, PTF_DIRTY, __ATOMIC_RELEASE) & PTF_DIRTY)){
+		__atomic_fetch_add(&vmem->counters.dirty, 1, __ATOMIC_RELAXED);
+	}
+}
 
-	// bit mask offset
+/**
+ *****************************************************************************************
+ *  @brief      This function records an access to a frame for page replacement 
+ *              algorithm LRU (the frame will become the most recently used one with
+ *              the next lru_flush) and aging (the reference bit of the frame will be
+ *              set). The reference bit will not be stored again if it is set, so 
+ *              threads accessing the same frames don't write the cache line.
+ *
+ *  @param      page_index Page that has been accessed.
+ *
+ *  @param      frame Frame that stores the page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void frame_access(int page_index, int frame) {
+	if(vmem->adm.page_rep_algo == VMEM_ALGO_LRU){
+		unsigned int gen = __atomic_load_n(&vmem->pt.framegen[frame], __ATOMIC_RELAXED);
+		__atomic_store_n(&pt[page_index].count, self->g_count, __ATOMIC_RELAXED);
+		if(lru_pending > 0 && lru_batch[lru_pending - 1].frame == frame){
+			lru_batch[lru_pending - 1].gen = gen; // repeated access: still the most recently used one
+			return;
+		}
+		if(lru_pending == VMEM_LRU_BATCH){
+			lru_flush();
+		}
+		lru_batch[lru_pending].frame = frame;
+		lru_batch[lru_pending].gen = gen;
+		lru_pending++;
+	} else if(vmem->adm.page_rep_algo == VMEM_ALGO_AGING){
+		if(__atomic_load_n(&vmem->pt.frame_ref[frame], __ATOMIC_RELAXED) != AGING_REF){
+			__atomic_store_n(&vmem->pt.frame_ref[frame], AGING_REF, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function counts hits of the calling thread. They will be added to
+ *              the hits of the client in batches.
+ *
+ *  @param      n Number of hits.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void count_hits(unsigned long n) {
+	hits += n;
+	if(hits >= VMEM_HITS_BATCH){
+		__atomic_fetch_add(&me->hits, hits, __ATOMIC_RELAXED);
+		hits = 0;
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function translates a virtual address into an index of vmem->data.
+ *              The page will be put into memory if required and the page table flags
+ *              will be set. The access will not be counted, see vmem_translate.
+ *
+ *  The translation cache tlb of the calling thread will be checked first. An entry is valid as long as the
+ *  generation counter of its frame has not been changed by mmanage, i.e. the page has
+ *  not been removed from this frame. It must be called between frames_enter and frames_leave.
+ *
+ *  @param      address The virtual memory address that should be translated.
+ *
+ *  @param      flags The page table flags that should be set (PTF_REF). 
+ *              PTF_DIRTY will be set by mark_dirty after the store.
+ *
+ *  @param      fault Set to TRUE if the page had to be put into memory, otherwise unchanged.
+ * 
+ *  @return     The index of address in vmem->data
+ ****************************************************************************************/
+static int vmem_translate_page(int address, int flags, int *fault) {
 	int offset = address & (VMEM_PAGESIZE -1);
-	//bit mask page
-	int page_index = (address&(~(VMEM_PAGESIZE -1))) / (VMEM_PAGESIZE);
-	int frame = vmem->pt.entries[page_index].frame;
-	vmem->adm.req_pageno= page_index;
-    TEST_AND_EXIT(page_index <  0,           (stderr, "page_index out of range\n"));
-    TEST_AND_EXIT(page_index >= VMEM_NPAGES, (stderr, "page_index out of range\n"));
-	vmem->pt.entries[page_index].flags = PTF_REF |vmem->pt.entries[page_index].flags ;
-	if(frame == VOID_IDX ){
-		kill(vmem->adm.mmanage_pid,SIGUSR1);
-		sem_wait(local_sem);
-	}
-	int page = (vmem->pt.entries[page_index].frame*(VMEM_PAGESIZE))|offset;
-    int holder =vmem->data[page];
-	TEST_AND_EXIT( page <  0,           (stderr, "page_index out of range\n"));
-	TEST_AND_EXIT( page >= 128 ,         (stderr, "page_index %i out of range\n",page));
-	vmem->adm.g_count++;
+	int page_index = address / VMEM_PAGESIZE;
+	struct tlb_entry *te = &tlb[page_index & (VMEM_TLB_SIZE - 1)];
+
+	TEST_AND_EXIT(address <  0,           (stderr, "address %i out of range\n", address));
+	TEST_AND_EXIT(page_index >= VMEM_NPAGES, (stderr, "page_index out of range\n"));
+	set_flags(page_index, flags);
+	if(te->page == page_index && vmem->pt.framegen[te->frame] == te->gen){
+		tlb_hits++;
+		frame_access(page_index, te->frame);
+		return te->frame * VMEM_PAGESIZE + offset;
+	}
+
+	tlb_misses++;
+	te->page = page_index;
+	te->frame = lookup_frame(page_index, &te->gen);
+	if(te->frame == VOID_IDX){
+		*fault = TRUE;
+		do {
+			vmem_page_fault(page_index);
+		} while((te->frame = lookup_frame(page_index, &te->gen)) == VOID_IDX);
+	}
+	TEST_AND_EXIT(te->frame <  0,           (stderr, "frame out of range\n"));
+	TEST_AND_EXIT(te->frame >= VMEM_NFRAMES, (stderr, "frame %i out of range\n", te->frame));
+	frame_access(page_index, te->frame);
+	return te->frame * VMEM_PAGESIZE + offset;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function counts a translated access as hit or page fault of this
+ *              client.
+ *
+ *  @param      fault TRUE if the page had to be put into memory.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void count_access(int fault) {
+	if(fault){
+		__atomic_fetch_add(&me->faults, 1, __ATOMIC_RELAXED);
+	} else {
+		count_hits(1);
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function translates a virtual address into an index of vmem->data
+ *              by vmem_translate_page and counts the access as hit or fault of this
+ *              client. It must be called between frames_enter and frames_leave.
+ *
+ *  @param      address The virtual memory address that should be translated.
+ *
+ *  @param      flags The page table flags that should be set (PTF_REF). 
+ * 
+ *  @return     The index of address in vmem->data
+ ****************************************************************************************/
+static int vmem_translate(int address, int flags) {
+	int fault = FALSE;
+	int idx = vmem_translate_page(address, flags, &fault);
+
+	count_access(fault);
+	return idx;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function does all work that has to be done after a memory access.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void vmem_access_done(void) {
+	self->g_count++;
 	if(vmem->adm.page_rep_algo == VMEM_ALGO_AGING){
 		update_age_reset_ref();
 	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function passes an access to trace_record and mrc_access. The 
+ *              accesses of all threads will be recorded one by one.
+ *
+ *  @param      address The accessed virtual memory address.
+ *
+ *  @param      is_write TRUE for a write access.
+ *
+ *  @param      g_count Access counter of the calling thread before the access.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void record_access(int address, int is_write, int g_count) {
+	pthread_mutex_lock(&record_lock);
+	if(tracing){
+		trace_record(address, is_write, g_count);
+	}
+	if(mrc){
+		mrc_access(address, g_count);
+	}
+	pthread_mutex_unlock(&record_lock);
+}
+
+int vmem_read(int address) {
+	if(self == NULL){
+		thread_attach();
+	}
+	if(tracing || mrc){
+		record_access(address, FALSE, self->g_count);
+	}
+	frames_enter();
+	int holder = vmem->data[vmem_translate(address, PTF_REF)];
+	frames_leave();
+	vmem_access_done();
 	return holder;
 }
 
 void vmem_write(int address, int data) {
-	if(vmem == NULL){
-		vmem_init();
+	if(self == NULL){
+		thread_attach();
 	}
+	if(tracing || mrc){
+		record_access(address, TRUE, self->g_count);
+	}
+	frames_enter();
+	vmem->data[vmem_translate(address, PTF_REF)] = data;
+	mark_dirty(address / VMEM_PAGESIZE);
+	frames_leave();
+	vmem_access_done();
+}
 
+/**
+ *****************************************************************************************
+ *  @brief      This function translates the two addresses of a compound access.
+ *              It must be called between frames_enter and frames_leave.
+ *
+ *  The frame of the first page will be pinned (vmem->pt.frame_pins) while the second
+ *  page is put into memory, so mmanage selects another victim if it can. If the first
+ *  page has been replaced anyway, both pages will be translated again. Each page
+ *  will be counted once as hit or fault when both translations are valid; a page
+ *  counts as fault if it had to be put into memory by any of the attempts. Both 
+ *  translations stay valid until frames_leave.
+ *
+ *  @param      addr1 The first virtual memory address.
+ *
+ *  @param      addr2 The second virtual memory address.
+ *
+ *  @param      idx1 Receives the index of addr1 in vmem->data.
+ *
+ *  @param      idx2 Receives the index of addr2 in vmem->data.
+ * 
+ *  @return     Number of pages translated: 1 if both addresses are in the same page, otherwise 2
+ ****************************************************************************************/
+static int vmem_translate_pair(int addr1, int addr2, int *idx1, int *idx2) {
+	int page1 = addr1 / VMEM_PAGESIZE;
+	int frame1 = 0;
+	unsigned int gen1 = 0;
+	int fault1 = FALSE;
+	int fault2 = FALSE;
 
-	// bit mask offset
-	int offset = address & (VMEM_PAGESIZE -1);
-	//bit mask page
-	int page_index = (address&(~(VMEM_PAGESIZE -1))) / (VMEM_PAGESIZE);
-    TEST_AND_EXIT(page_index <  0,           (stderr, "page_index out of range\n"));
-    TEST_AND_EXIT(page_index >= VMEM_NPAGES, (stderr, "page_index out of range\n"));
-	vmem->adm.req_pageno= page_index;
-	int frame = vmem->pt.entries[page_index].frame;
-	vmem->pt.entries[page_index].flags = PTF_DIRTY| PTF_REF | vmem->pt.entries[page_index].flags;
-	if(frame == VOID_IDX ){
-		kill(vmem->adm.mmanage_pid,SIGUSR1);
-		sem_wait(local_sem);
-	}
-	int page = (vmem->pt.entries[page_index].frame*(VMEM_PAGESIZE))|offset;
-	TEST_AND_EXIT( page <  0,           (stderr, "page_index out of range\n"));
-	TEST_AND_EXIT( page >= 128 ,         (stderr, "page_index %i out of range\n",page));
-	vmem->data[page] = data;
-	vmem->adm.g_count++;
-	if(vmem->adm.page_rep_algo == VMEM_ALGO_AGING){
-		update_age_reset_ref();
+	if(addr2 >= 0 && page1 == addr2 / VMEM_PAGESIZE){
+		*idx1 = vmem_translate(addr1, PTF_REF);
+		*idx2 = *idx1 + (addr2 - addr1);
+		return 1;
+	}
+	do {
+		*idx1 = vmem_translate_page(addr1, PTF_REF, &fault1);
+		frame1 = *idx1 / VMEM_PAGESIZE;
+		gen1 = tlb[page1 & (VMEM_TLB_SIZE - 1)].gen;
+		__atomic_fetch_add(&vmem->pt.frame_pins[frame1], 1, __ATOMIC_RELAXED);
+		*idx2 = vmem_translate_page(addr2, PTF_REF, &fault2);
+		__atomic_fetch_sub(&vmem->pt.frame_pins[frame1], 1, __ATOMIC_RELAXED);
+	} while(__atomic_load_n(&vmem->pt.framegen[frame1], __ATOMIC_ACQUIRE) != gen1);
+	count_access(fault1);
+	count_access(fault2);
+	return 2;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function finishes the n accesses of a compound access: each one
+ *              will be recorded and does the work of vmem_access_done.
+ *
+ *  @param      address The accessed virtual memory addresses in program order.
+ *
+ *  @param      is_write TRUE for the write accesses.
+ *
+ *  @param      n Number of accesses.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void vmem_accesses_done(const int *address, const int *is_write, int n) {
+	int k;
+	for(k = 0; k < n; k++){
+		if(tracing || mrc){
+			record_access(address[k], is_write[k], self->g_count);
+		}
+		vmem_access_done();
+	}
+}
+
+void vmem_swap(int addr1, int addr2) {
+	static const int is_write[] = {FALSE, FALSE, TRUE, TRUE};
+	int address[] = {addr1, addr2, addr1, addr2};
+	int idx1 = 0;
+	int idx2 = 0;
+	int tmp = 0;
+
+	if(self == NULL){
+		thread_attach();
+	}
+	frames_enter();
+	count_hits(4 - vmem_translate_pair(addr1, addr2, &idx1, &idx2));
+	tmp = vmem->data[idx1];
+	vmem->data[idx1] = vmem->data[idx2];
+	vmem->data[idx2] = tmp;
+	mark_dirty(addr1 / VMEM_PAGESIZE);
+	mark_dirty(addr2 / VMEM_PAGESIZE);
+	frames_leave();
+	vmem_accesses_done(address, is_write, 4);
+}
+
+int vmem_cas(int address, int expected, int desired) {
+	static const int is_write[] = {FALSE, TRUE};
+	int addresses[] = {address, address};
+	int done = FALSE;
+
+	if(self == NULL){
+		thread_attach();
+	}
+	frames_enter();
+	int idx = vmem_translate(address, PTF_REF);
+	done = __atomic_compare_exchange_n(&vmem->data[idx], &expected, desired, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	if(done){
+		count_hits(1);
+		mark_dirty(address / VMEM_PAGESIZE);
+	}
+	frames_leave();
+	vmem_accesses_done(addresses, is_write, done ? 2 : 1);
+	return expected; // the value found, also if it has been replaced
+}
+
+int vmem_fetch_add(int address, int delta) {
+	static const int is_write[] = {FALSE, TRUE};
+	int addresses[] = {address, address};
+
+	if(self == NULL){
+		thread_attach();
 	}
+	frames_enter();
+	int holder = __atomic_fetch_add(&vmem->data[vmem_translate(address, PTF_REF)], delta, __ATOMIC_SEQ_CST);
+	count_hits(1);
+	mark_dirty(address / VMEM_PAGESIZE);
+	frames_leave();
+	vmem_accesses_done(addresses, is_write, 2);
+	return holder;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function fills a frame region with value. The region will be
+ *              filled by memcpy calls of doubling size, so the vectorized memcpy
+ *              of the C library does the work.
+ *
+ *  @param      dst First int of the region
+ *
+ *  @param      value The value to be written.
+ *
+ *  @param      n Number of ints to be written.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+static void fill_ints(int *dst, int value, int n) {
+	int done = 1;
+	if(n <= 0){
+		return;
+	}
+	dst[0] = value;
+	while(done < n){
+		int k = (done < n - done) ? done : n - done;
+		memcpy(dst + done, dst, k * sizeof(int));
+		done += k;
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements vmem_read_range, vmem_write_range and vmem_memset.
+ *
+ *  The range will be handled in page sized chunks. A chunk will be split further 
+ *  when the aging algorithm is active and the counter of the thread reaches a multiple of 
+ *  UPDATE_AGE_COUNT inside the chunk: update_age_reset_ref runs at the same
+ *  access as with single accesses and the reference flag will be set again for the 
+ *  rest of the chunk.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      rbuf Destination buffer (read) or NULL.
+ *
+ *  @param      wbuf Source buffer (write) or NULL.
+ *
+ *  @param      value Value to be written if rbuf and wbuf are NULL (memset).
+ *
+ *  @param      count Number of integer values.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+static void vmem_range(int address, int *rbuf, const int *wbuf, int value, int count) {
+	if(self == NULL){
+		thread_attach();
+	}
+	frames_enter();
+	while(count > 0){
+		int n = VMEM_PAGESIZE - (address & (VMEM_PAGESIZE - 1));
+		if(n > count){
+			n = count;
+		}
+		int idx = vmem_translate(address, PTF_REF);
+		count_hits(n - 1); // all but the first access of the chunk
+		while(n > 0){
+			int step = n;
+			int k;
+			if(vmem->adm.page_rep_algo == VMEM_ALGO_AGING){
+				int left = UPDATE_AGE_COUNT - (self->g_count % UPDATE_AGE_COUNT);
+				step = (left < n) ? left : n;
+			}
+			for(k = 0; (tracing || mrc) && k < step; k++){
+				record_access(address + k, rbuf == NULL, self->g_count + k);
+			}
+			if(rbuf != NULL){
+				memcpy(rbuf, &vmem->data[idx], step * sizeof(int));
+				rbuf += step;
+			} else if(wbuf != NULL){
+				memcpy(&vmem->data[idx], wbuf, step * sizeof(int));
+				wbuf += step;
+			} else {
+				fill_ints(&vmem->data[idx], value, step);
+			}
+			if(rbuf == NULL){
+				mark_dirty(address / VMEM_PAGESIZE);
+			}
+			self->g_count += step;
+			if(vmem->adm.page_rep_algo == VMEM_ALGO_AGING){
+				update_age_reset_ref();
+			}
+			idx += step;
+			address += step;
+			count -= step;
+			n -= step;
+			if(n > 0){
+				set_flags(address / VMEM_PAGESIZE, PTF_REF);
+				frame_access(address / VMEM_PAGESIZE, idx / VMEM_PAGESIZE);
+			}
+		}
+	}
+	frames_leave();
+}
+
+void vmem_read_range(int address, int *buf, int count) {
+	vmem_range(address, buf, NULL, 0, count);
+}
+
+void vmem_write_range(int address, const int *buf, int count) {
+	vmem_range(address, NULL, buf, 0, count);
+}
+
+void vmem_memset(int address, int value, int count) {
+	vmem_range(address, NULL, NULL, value, count);
 }
 
 // EOF
@@ -4,16 +4,71 @@
  * @date 2010
  * @brief This module defines function to read from and write to
  * virtual memory.
+ *
+ * All functions may be called by several threads of a process at the same time.
+ * Up to VMEM_MAXTHREADS threads of all clients may access the virtual memory.
  */
 
 #ifndef VMACCESS_H
 #define VMACCESS_H
 
+/**
+ *****************************************************************************************
+ *  @brief      This function sets up in-process simulation. The memory manager core
+ *              (libmmanage.a) will be called directly on page faults. There is no
+ *              shared memory and no mmanage process.
+ *
+ *              It must be called before the first access to virtual memory.
+ *              Pagefile and logfile will be the same as those of mmanage.
+ *
+ *  @param      page_rep_algo Page replacement algorithm; see VMEM_ALGO_* in vmem.h
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_init_inproc(int page_rep_algo);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function starts the computation of miss ratio curves of all 
+ *              following accesses to virtual memory (see mrc.h). The result will be 
+ *              written to a CSV file when the program terminates. The computation will
+ *              be started automatically if the environment variable VMEM_MRC names a file.
+ *
+ *  @param      name Name of the result file.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_mrc(const char *name);
+
+struct vmem_stats;
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the latency histograms of the fault path 
+ *              (see stats.h), e.g. for benchmarks of the in-process simulation.
+ *
+ *  @return     The histograms; NULL before the first access to virtual memory.
+ ****************************************************************************************/
+const struct vmem_stats *vmem_get_stats(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function starts recording all following accesses to virtual memory
+ *              into an address trace file (see trace.h). Recording will be started 
+ *              automatically if the environment variable VMEM_TRACE names a trace file.
+ *
+ *  @param      name Name of the trace file.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_trace(const char *name);
+
 /**
  *****************************************************************************************
  *  @brief      This function reads an integer value from virtual memory.
  *              If this functions access virtual memory for the first time, the 
- *              virtual memory will be setup and initialized.
+ *              virtual memory will be setup and initialized. On the first access
+ *              of a thread, the thread attaches to mmanage.
  *
  *  @param      address The virtual memory address the integer value should be read from.
  * 
@@ -25,7 +80,8 @@ int vmem_read(int address);
  *****************************************************************************************
  *  @brief      This function writes an integer value from virtual memory.
  *              If this functions access virtual memory for the first time, the 
- *              virtual memory will be setup and initialized.
+ *              virtual memory will be setup and initialized. On the first access
+ *              of a thread, the thread attaches to mmanage.
  *
  *  @param      address The virtual memory address the integer value should be written to.
  *
@@ -35,4 +91,112 @@ int vmem_read(int address);
  ****************************************************************************************/
 void vmem_write(int address, int data);
 
+/**
+ *****************************************************************************************
+ *  @brief      This function reads count consecutive integer values from virtual memory.
+ *
+ *  The range will be copied page by page. Each page will be put into memory at most
+ *  once and its flags will be set once. Page faults, the global counter and the 
+ *  aging algorithm behave exactly like count calls of vmem_read with increasing
+ *  addresses.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      buf The buffer that receives the count values.
+ *
+ *  @param      count Number of integer values to be read.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_read_range(int address, int *buf, int count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes count consecutive integer values to virtual memory.
+ *
+ *  It behaves like count calls of vmem_write with increasing addresses. 
+ *  See vmem_read_range.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      buf The buffer that contains the count values.
+ *
+ *  @param      count Number of integer values to be written.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_write_range(int address, const int *buf, int count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sets count consecutive integer values of virtual memory 
+ *              to value.
+ *
+ *  It behaves like count calls of vmem_write with increasing addresses. 
+ *  See vmem_read_range.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      value The value to be written.
+ *
+ *  @param      count Number of integer values to be written.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_memset(int address, int value, int count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function exchanges two integer values of virtual memory.
+ *
+ *  Both pages will be translated once and stay in memory until both values have 
+ *  been exchanged: the page of addr1 is pinned while the page of addr2 is put into
+ *  memory, so it will not be replaced by that page fault unless all frames are pinned.
+ *  The global counter counts four accesses like the sequence 
+ *  tmp = vmem_read(addr1); vmem_write(addr1, vmem_read(addr2)); vmem_write(addr2, tmp);
+ *  aging runs after the exchange. The exchange is not atomic with respect to other 
+ *  threads that access one of the values at the same time.
+ *
+ *  @param      addr1 The virtual memory address of the first value.
+ *
+ *  @param      addr2 The virtual memory address of the second value.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_swap(int addr1, int addr2);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function replaces an integer value of virtual memory by desired 
+ *              if it equals expected. The comparison and the store are atomic, also
+ *              with respect to other threads and clients.
+ *
+ *  The page will be translated once. The global counter counts a read access and,
+ *  if the value has been replaced, a write access.
+ *
+ *  @param      address The virtual memory address of the value.
+ *
+ *  @param      expected The expected value.
+ *
+ *  @param      desired The new value.
+ * 
+ *  @return     The value found at address; the value has been replaced if it equals expected.
+ ****************************************************************************************/
+int vmem_cas(int address, int expected, int desired);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adds delta to an integer value of virtual memory. The
+ *              addition is atomic, also with respect to other threads and clients.
+ *
+ *  The page will be translated once. The global counter counts a read and a write access.
+ *
+ *  @param      address The virtual memory address of the value.
+ *
+ *  @param      delta The value to be added.
+ * 
+ *  @return     The value before the addition.
+ ****************************************************************************************/
+int vmem_fetch_add(int address, int delta);
+
 #endif
@@ -10,6 +10,13 @@
 #include <string.h>
 #include "vmaccess.h"
 #include "vmappl.h"
+#include "vmem.h"
+#include "instance.h"
+#include "pagefile.h"
+#include "logger.h"
+#include "workload.h"
+#include "psort.h"
+#include "mrc.h"
 #include "mytypes.h"
 
 /* 
@@ -69,7 +76,8 @@ static void sort(int length);
  *  @brief      This function swaps two int values of virtual memory 
  *
  *  Call this function to swap two int elements stored at addr1 and addr2 
- *  of virtual memory.
+ *  of virtual memory. The elements will be swapped by vmem_swap; with -legacy by
+ *  two reads and two writes, which gives the page faults of the reference logfiles.
  * 
  *  @param      addr1 address of first elment in virtual memory 
  *
@@ -122,6 +130,12 @@ static void print_usage_info_and_exit(char *err_str);
 static char *program_name = NULL;
 static int sort_algo      = QUICK_SORT; // select default sort algorithm
 static int seed           = SEED; // select default init value for random number generator 
+static int inproc         = FALSE; // in-process simulation without mmanage
+static int page_rep_algo  = VMEM_ALGO_FIFO; // page replacement algorithm of in-process simulation
+static int init_type      = INIT_TYPE_SEED; // initial order of the array to be sorted
+static char *mrc_name     = NULL; // miss ratio curve file
+static int length         = LENGTH; // length of the array to be sorted
+static int legacy         = FALSE; // swap by single reads and writes instead of vmem_swap
 
 /* 
  * functions of the module 
@@ -132,8 +146,17 @@ void scan_params(int argc, char **argv) {
     int i = 0;
     unsigned char sort_algo_param_found = FALSE;
     unsigned char seed_param_found      = FALSE;
+    unsigned char algo_param_found      = FALSE;
+    unsigned char pf_param_found        = FALSE;
+    unsigned char log_param_found       = FALSE;
     unsigned char param_ok              = FALSE;
     const char *seed_str = "-seed=";
+    const char *instance_str = "-instance=";
+    const char *trace_str = "-trace=";
+    const char *init_str = "-init=";
+    const char *mrc_str = "-mrc=";
+    const char *length_str = "-length=";
+    unsigned char length_param_found    = FALSE;
 
     // scan all parameters (argv[0] points to program name)
     for (i = 1; i < argc; i++) {
@@ -152,7 +175,28 @@ void scan_params(int argc, char **argv) {
             sort_algo_param_found = TRUE;
             param_ok = TRUE;
         }
-        if ( 0 == strncasecmp(seed_str, argv[i], sizeof(seed_str)) ) {
+        if (0 == strcasecmp("-pquicksort", argv[i]) || 0 == strcasecmp("-pmergesort", argv[i]) ||
+            0 == strcasecmp("-samplesort", argv[i])) {
+            // parallel sort algorithm selected
+            if (sort_algo_param_found) print_usage_info_and_exit("Two sort algorthm selected.\n");
+            sort_algo = (0 == strcasecmp("-pquicksort", argv[i])) ? PQUICK_SORT :
+                        (0 == strcasecmp("-pmergesort", argv[i])) ? PMERGE_SORT : SAMPLE_SORT;
+            sort_algo_param_found = TRUE;
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(length_str, argv[i], strlen(length_str))) {
+            // length of the array
+            if (1 != sscanf(argv[i] + strlen(length_str), "%d", &length) || length <= 0) {
+                print_usage_info_and_exit("Invalid length.\n");
+            }
+            length_param_found = TRUE;
+            param_ok = TRUE;
+        }
+        if (psort_option(argv[i])) {
+            // threads of the parallel sorts
+            param_ok = TRUE;
+        }
+        if ( 0 == strncasecmp(seed_str, argv[i], strlen(seed_str)) ) {
             // seed parameter found 
             if ( 1 == sscanf(argv[i]+strlen(seed_str), "%d", &seed) ) {
                 if (seed_param_found) print_usage_info_and_exit("Two seed values defined.\n");
@@ -160,8 +204,83 @@ void scan_params(int argc, char **argv) {
                 param_ok = TRUE;
             }
         }
+        if (0 == strncasecmp(instance_str, argv[i], strlen(instance_str))) {
+            // instance id of the simulation
+            instance_init(argv[i] + strlen(instance_str));
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(trace_str, argv[i], strlen(trace_str))) {
+            // record address trace
+            vmem_trace(argv[i] + strlen(trace_str));
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(mrc_str, argv[i], strlen(mrc_str))) {
+            // miss ratio curves
+            mrc_name = argv[i] + strlen(mrc_str);
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-legacy", argv[i])) {
+            // access sequence of the reference logfiles
+            legacy = TRUE;
+            psort_legacy();
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-inproc", argv[i])) {
+            // in-process simulation selected
+            inproc = TRUE;
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-fifo", argv[i]) || 0 == strcasecmp("-clock", argv[i]) || 
+            0 == strcasecmp("-aging", argv[i]) || 0 == strcasecmp("-lru", argv[i])) {
+            // page replacement algorithm of in-process simulation
+            if (algo_param_found) print_usage_info_and_exit("Two page replacement algorithms selected.\n");
+            page_rep_algo = (0 == strcasecmp("-fifo", argv[i]))  ? VMEM_ALGO_FIFO :
+                            (0 == strcasecmp("-clock", argv[i])) ? VMEM_ALGO_CLOCK :
+                            (0 == strcasecmp("-aging", argv[i])) ? VMEM_ALGO_AGING : VMEM_ALGO_LRU;
+            algo_param_found = TRUE;
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(init_str, argv[i], strlen(init_str))) {
+            // initial order of the array
+            const char *t = argv[i] + strlen(init_str);
+            init_type = (0 == strcasecmp("random", t)) ? INIT_TYPE_SEED :
+                        (0 == strcasecmp("up", t))     ? INIT_TYPE_UP :
+                        (0 == strcasecmp("down", t))   ? INIT_TYPE_DOWN : -1;
+            if (init_type == -1) print_usage_info_and_exit("Unknown init type.\n");
+            param_ok = TRUE;
+        }
+        if (logger_option(argv[i])) {
+            // binary logfile of in-process simulation
+            log_param_found = TRUE;
+            param_ok = TRUE;
+        }
+        if (pagefile_option(argv[i])) {
+            // pagefile backend of in-process simulation
+            pf_param_found = TRUE;
+            param_ok = TRUE;
+        }
+        if (mrc_option(argv[i])) {
+            // sampled miss ratio curves
+            param_ok = TRUE;
+        }
+        if (workload_option(argv[i])) {
+            // synthetic workload instead of sorting
+            param_ok = TRUE;
+        }
         if (!param_ok) print_usage_info_and_exit("Undefined parameter.\n"); // undefined parameter found
     } // for loop
+    if (sort_algo_param_found && workload_selected() != WORKLOAD_NONE) {
+        print_usage_info_and_exit("Sort algorithm and workload selected.\n");
+    }
+    if (algo_param_found && !inproc) print_usage_info_and_exit("Page replacement algorithm requires -inproc.\n");
+    if (pf_param_found && !inproc) print_usage_info_and_exit("Pagefile options require -inproc.\n");
+    if (log_param_found && !inproc) print_usage_info_and_exit("-binlog requires -inproc (or -binlog of mmanage).\n");
+    if (sort_algo == PMERGE_SORT || sort_algo == SAMPLE_SORT) {
+        // the upper half of virtual memory is the buffer
+        if (!length_param_found) length = VMEM_VIRTMEMSIZE / 2;
+        if (length > VMEM_VIRTMEMSIZE / 2) print_usage_info_and_exit("Array does not fit into virtual memory.\n");
+    }
+    if (length > VMEM_VIRTMEMSIZE) print_usage_info_and_exit("Array does not fit into virtual memory.\n");
 }
 
 int main(int argc, char **argv) {
@@ -169,28 +288,48 @@ int main(int argc, char **argv) {
 
     program_name = argv[0];
     scan_params(argc, argv);
-    printf("seed = %d sort algorithm = %s\n", seed, 
-           (sort_algo == QUICK_SORT) ? "Quick Sort" : (sort_algo == BUBBLE_SORT) ? "Bubble Sort" : "undefined");
+    if (mrc_name != NULL) {
+        vmem_mrc(mrc_name);
+    }
+    if (workload_selected() != WORKLOAD_NONE) {
+        if (inproc) {
+            vmem_init_inproc(page_rep_algo);
+        }
+        workload_run(seed);
+        return 0;
+    }
+    printf("seed = %d sort algorithm = %s", seed, 
+           (sort_algo == QUICK_SORT)  ? "Quick Sort" : (sort_algo == BUBBLE_SORT) ? "Bubble Sort" :
+           (sort_algo == PQUICK_SORT) ? "Parallel Quick Sort" : (sort_algo == PMERGE_SORT) ? "Parallel Merge Sort" :
+           (sort_algo == SAMPLE_SORT) ? "Sample Sort" : "undefined");
+    if (sort_algo == PQUICK_SORT || sort_algo == PMERGE_SORT || sort_algo == SAMPLE_SORT) {
+        printf(" threads = %d length = %d", psort_threads(), length);
+    }
+    printf("\n");
     fflush(stdout); 
 
+    if (inproc) {
+        vmem_init_inproc(page_rep_algo);
+    }
+
     /* Fill memory with pseudo-random data */
-    if (LENGTH <= 0) {
+    if (length <= 0) {
         fprintf(stderr, "LENGTH (array size) out of range");
         exit(EXIT_FAILURE); 
     }
-    init_data(LENGTH);
+    init_data(length);
 
     /* Display unsorted */
     printf("\nUnsorted:\n");
-    display_data(LENGTH);
+    display_data(length);
 
     /* Sort */
     printf("\nSorting:\n");
-    sort(LENGTH);
+    sort(length);
 
     /* Display sorted */
     printf("\nSorted:\n");
-    display_data(LENGTH);
+    display_data(length);
     printf("\n");
 
     return 0;
@@ -198,21 +337,33 @@ int main(int argc, char **argv) {
 
 void init_data(int length) {
     int i;
-    int val;
+    int val[length];
 
     /* Init random generator */
     srand(seed);
 
     for(i = 0; i < length; i++) {
-        val = rand() % RNDMOD;
-        vmem_write(i, val);
+        switch (init_type) {
+           case INIT_TYPE_UP :
+               val[i] = i;
+               break;
+           case INIT_TYPE_DOWN :
+               val[i] = length - 1 - i;
+               break;
+           default:
+               val[i] = rand() % RNDMOD;
+        }
     }   /* end for */
+    vmem_write_range(0, val, length);
 }
 
 void display_data(int length) {
     int i;
+    int val[length];
+
+    vmem_read_range(0, val, length);
     for(i = 0; i < length; i++) {
-        printf("%10d", vmem_read(i));
+        printf("%10d", val[i]);
         printf("%c", ((i + 1) % NDISPLAYCOLS) ? ' ' : '\n');
     }   /* end for */
 }
@@ -226,6 +377,15 @@ void sort(int length) {
        case BUBBLE_SORT :
            bubblesort(0, length - 1);
            break;
+       case PQUICK_SORT :
+           psort_quicksort(length);
+           break;
+       case PMERGE_SORT :
+           psort_mergesort(length);
+           break;
+       case SAMPLE_SORT :
+           psort_samplesort(length);
+           break;
        default:
            fprintf(stderr, "Undefined sort algorithm in function sort");
            exit(EXIT_FAILURE); 
@@ -267,6 +427,10 @@ void quicksort(int l, int r) {
 }
 
 void swap(int addr1, int addr2) {
+    if (!legacy) {
+        vmem_swap(addr1, addr2);
+        return;
+    }
     int tmp = vmem_read(addr1);
     vmem_write(addr1, vmem_read(addr2));
     vmem_write(addr2, tmp);
@@ -277,8 +441,24 @@ void print_usage_info_and_exit(char *err_str) {
     fprintf(stderr, "Usage : %s [OPTIONS]\n", program_name);
     fprintf(stderr, " -quicksort : Use quicksort algorithm\n");
     fprintf(stderr, " -bubblesort : Use bubblesort algorithm\n");
+    fprintf(stderr, " -pquicksort | -pmergesort | -samplesort : Use a parallel sort algorithm, see psort.h\n");
+    fprintf(stderr, " -length=<n> : Length of the array to be sorted (default %d; %d for -pmergesort\n", LENGTH, VMEM_VIRTMEMSIZE / 2);
+    fprintf(stderr, "               and -samplesort, they use the upper half of virtual memory as buffer)\n");
     fprintf(stderr, " -seed=<int value> : Init randon number generator for generating the numbers\n");
     fprintf(stderr, "                     of the array to be sorted with <int value>\n");
+    fprintf(stderr, " -init=random|up|down : Initial order of the array to be sorted (default random)\n");
+    fprintf(stderr, " -legacy : Swap elements by single reads and writes instead of vmem_swap\n");
+    fprintf(stderr, "           (access sequence of the reference logfiles)\n");
+    fprintf(stderr, " -inproc : Simulate in this process, no mmanage required\n");
+    fprintf(stderr, " -trace=<file> : Record all accesses to virtual memory in <file>\n");
+    fprintf(stderr, " -mrc=<file> : Write the miss ratio curves of all accesses to <file> (CSV)\n");
+    fprintf(stderr, " -instance=<id> : Instance id of the simulation (default: $%s)\n", INSTANCE_ENV);
+    fprintf(stderr, " -fifo | -clock | -aging | -lru : Page replacement algorithm of -inproc\n");
+    psort_usage();
+    mrc_usage();
+    workload_usage();
+    pagefile_usage();
+    logger_usage();
     fflush(stderr);
     exit(EXIT_FAILURE);
 }
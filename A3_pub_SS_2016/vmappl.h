@@ -24,5 +24,8 @@
 
 #define QUICK_SORT     10  // use quick sort 
 #define BUBBLE_SORT    11  // use bubble  sort 
+#define PQUICK_SORT    12  // use parallel quick sort, see psort.h
+#define PMERGE_SORT    13  // use parallel merge sort
+#define SAMPLE_SORT    14  // use parallel sample sort
 
 #endif
@@ -0,0 +1,474 @@
+/**
+ * @file vmbench.c
+ * @brief Microbenchmarks of the hit path of vmaccess and the fault path of mmcore.
+ *
+ * vmbench runs the in-process simulation (vmem_init_inproc) with one page
+ * replacement algorithm and measures the time per operation of:
+ *
+ *   read_hit     vmem_read of a resident page
+ *   write_hit    vmem_write of a resident page
+ *   fault_clean  page fault that replaces a page that has not been modified
+ *   fault_dirty  page fault that replaces a modified page
+ *   find_remove  selection of the victim (find_remove_* of mmcore.c) on the full
+ *                frame table, see mmcore_time_victims
+ *   update_age   one aging step of all frames as done by update_age_reset_ref:
+ *                aging_step with lock and atomic exchange of the reference bits
+ *                (-aging only)
+ *
+ * With -threads=<n> the hit cases run in n threads at the same time, each on a
+ * page of its own. Their time per operation is the elapsed time divided by the
+ * accesses of all threads, so it drops with the number of threads as long as 
+ * the hit path scales. With LRU a thread takes the lock of the shared list once
+ * per VMEM_LRU_BATCH accesses to different frames (see vmaccess.c); the hit 
+ * cases access a single page per thread, so they measure the path without it.
+ *
+ * Each case runs warmup + reps repetitions, the median, the quartiles and the
+ * minimum of the repetitions are printed as CSV or JSON lines (one object per
+ * case). The page size is a compile time constant, see run_bench for all
+ * page sizes and algorithms, e.g.
+ *
+ *     ./vmbench -clock -format=json
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "vmaccess.h"
+#include "vmem.h"
+#include "aging.h"
+#include "mmcore.h"
+#include "instance.h"
+#include "pagefile.h"
+#include "logger.h"
+#include "mytypes.h"
+#include "debug.h"
+
+#define BENCH_FORMAT_CSV  0 //!< Comma separated values
+#define BENCH_FORMAT_JSON 1 //!< One JSON object per line
+
+#define BENCH_MAX_REPS 1000 //!< Max. number of repetitions of a case
+#define BENCH_MAX_THREADS 64 //!< Max. number of threads of the hit cases
+
+/**
+ * Result of one case: time per operation of each repetition
+ */
+struct bench_result {
+    const char *name;           //!< name of the case
+    int reps;                   //!< number of repetitions
+    double ns[BENCH_MAX_REPS];  //!< ns per operation of each repetition
+};
+
+/**
+ * Work of one thread of a hit case
+ */
+struct hit_job {
+    int write;                  //!< TRUE: vmem_write, FALSE: vmem_read
+    int page;                   //!< the accessed page
+};
+
+/*
+ * Signatures of private (static) functions of this module.
+ */
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans all parameters of the program.
+ *              The corresponding static variables will be set.
+ *
+ *  @param      argc number of parameter
+ *
+ *  @param      argv parameter list
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void scan_params(int argc, char **argv);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints an error message and the usage information of
+ *              this program.
+ *
+ *  @param      err_str pointer to the error string that should be printed.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void print_usage_info_and_exit(char *err_str);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function runs the hit path cases read_hit and write_hit.
+ *
+ *  @param      r Result of the case.
+ *
+ *  @param      write TRUE: vmem_write, FALSE: vmem_read
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void bench_hit(struct bench_result *r, int write);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function does the accesses of one repetition of a hit case.
+ *
+ *  @param      arg The work of the thread (struct hit_job).
+ *
+ *  @return     NULL
+ ****************************************************************************************/
+static void *hit_loop(void *arg);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function runs the fault path cases. All pages will be accessed
+ *              cyclically, so (nearly) each access is a page fault.
+ *              The time per page fault will be recorded.
+ *
+ *  @param      r Result of the case.
+ *
+ *  @param      write TRUE: the victims are dirty, FALSE: the victims are clean
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void bench_fault(struct bench_result *r, int write);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function runs case find_remove: ops selections of a victim per
+ *              repetition, timed as a whole by mmcore_time_victims. The frame
+ *              table must be full, i.e. a fault case must have run before.
+ *
+ *  @param      r Result of the case.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void bench_find_remove(struct bench_result *r);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function runs case update_age: aging_step for all frames, the
+ *              call update_age_reset_ref does every UPDATE_AGE_COUNT accesses.
+ *
+ *  @param      r Result of the case.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void bench_update_age(struct bench_result *r);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the statistic of a case.
+ *
+ *  @param      r Result of the case.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void report(struct bench_result *r);
+
+/*
+ * static global variables
+ */
+static char *program_name  = NULL;
+static int page_rep_algo   = VMEM_ALGO_FIFO;  // page replacement algorithm
+static int reps            = 21;              // measured repetitions per case
+static int warmup          = 3;               // repetitions before measurement
+static long ops            = 1000000;         // accesses per repetition of the hit cases
+static long faults         = 5000;            // accesses per repetition of the fault cases
+static int threads         = 1;               // threads of the hit cases
+static int format          = BENCH_FORMAT_CSV;
+static int header          = FALSE;           // print CSV header line
+static volatile int sink   = 0;               // keeps the results of vmem_read alive
+
+static const char *algo_names[] = { "fifo", "aging", "clock", "lru" }; // index VMEM_ALGO_*
+
+int main(int argc, char **argv) {
+    static struct bench_result r[6];
+
+    program_name = argv[0];
+    scan_params(argc, argv);
+    vmem_init_inproc(page_rep_algo);
+
+    r[0].name = "read_hit";
+    bench_hit(&r[0], FALSE);
+    r[1].name = "write_hit";
+    bench_hit(&r[1], TRUE);
+    r[2].name = "fault_clean";
+    bench_fault(&r[2], FALSE);
+    r[3].name = "fault_dirty";
+    bench_fault(&r[3], TRUE);
+    r[4].name = "find_remove";
+    bench_find_remove(&r[4]);
+    r[5].name = "update_age";
+    if (page_rep_algo == VMEM_ALGO_AGING) {
+        bench_update_age(&r[5]); // no aging step with the other algorithms
+    }
+
+    if (header && format == BENCH_FORMAT_CSV) {
+        printf("pagesize,algo,case,reps,median_ns,q1_ns,q3_ns,iqr_ns,min_ns\n");
+    }
+    report(&r[0]);
+    report(&r[1]);
+    report(&r[2]);
+    report(&r[3]);
+    report(&r[4]);
+    report(&r[5]);
+    return 0;
+}
+
+void bench_hit(struct bench_result *r, int write) {
+    pthread_t tid[BENCH_MAX_THREADS];
+    struct hit_job job[BENCH_MAX_THREADS];
+    unsigned long long start;
+    int rep, t;
+
+    for (t = 0; t < threads; t++) {
+        job[t].write = write;
+        job[t].page = t % VMEM_NPAGES;
+        vmem_read(job[t].page * VMEM_PAGESIZE); // the page is resident from now on
+    }
+    r->reps = 0;
+    for (rep = 0; rep < warmup + reps; rep++) {
+        start = stats_now();
+        if (threads == 1) {
+            hit_loop(&job[0]);
+        } else {
+            for (t = 0; t < threads; t++) {
+                TEST_AND_EXIT(pthread_create(&tid[t], NULL, hit_loop, &job[t]) != 0, (stderr, "Error creating thread\n"));
+            }
+            for (t = 0; t < threads; t++) {
+                pthread_join(tid[t], NULL);
+            }
+        }
+        if (rep >= warmup) {
+            r->ns[r->reps++] = (double) (stats_now() - start) / ((double) ops * threads);
+        }
+    }
+}
+
+void *hit_loop(void *arg) {
+    struct hit_job *job = arg;
+    int base = job->page * VMEM_PAGESIZE;
+    int sum = 0;
+    long i;
+
+    if (job->write) {
+        for (i = 0; i < ops; i++) {
+            vmem_write(base + (i & (VMEM_PAGESIZE - 1)), i);
+        }
+    } else {
+        for (i = 0; i < ops; i++) {
+            sum += vmem_read(base + (i & (VMEM_PAGESIZE - 1)));
+        }
+    }
+    __atomic_fetch_add(&sink, sum, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+void bench_fault(struct bench_result *r, int write) {
+    const struct vmem_stats *s = vmem_get_stats();
+    unsigned long long start;
+    unsigned long n;
+    long i;
+    int rep;
+    int page = 0;
+
+    r->reps = 0;
+    for (rep = 0; rep < warmup + reps; rep++) {
+        n = s->fault.total;
+        start = stats_now();
+        for (i = 0; i < faults; i++) {
+            if (write) {
+                vmem_write(page * VMEM_PAGESIZE, i);
+            } else {
+                sink += vmem_read(page * VMEM_PAGESIZE);
+            }
+            page = (page == VMEM_NPAGES - 1) ? 0 : page + 1;
+        }
+        if (rep >= warmup && s->fault.total > n) {
+            r->ns[r->reps++] = (double) (stats_now() - start) / (s->fault.total - n);
+        }
+    }
+}
+
+void bench_find_remove(struct bench_result *r) {
+    unsigned long long t;
+    int rep;
+
+    r->reps = 0;
+    for (rep = 0; rep < warmup + reps; rep++) {
+        t = mmcore_time_victims(ops);
+        if (t == 0) {
+            return; // unused frames: no victim selection
+        }
+        if (rep >= warmup) {
+            r->ns[r->reps++] = (double) t / ops;
+        }
+    }
+}
+
+void bench_update_age(struct bench_result *r) {
+    unsigned char age[VMEM_NFRAMES];
+    unsigned char ref[VMEM_NFRAMES];
+    int lock = 0;
+    unsigned long long start;
+    long i;
+    int rep;
+
+    memset(age, 0, sizeof(age));
+    memset(ref, 0, sizeof(ref));
+    r->reps = 0;
+    for (rep = 0; rep < warmup + reps; rep++) {
+        start = stats_now();
+        for (i = 0; i < ops; i++) {
+            ref[i % VMEM_NFRAMES] = AGING_REF; // one access per tick, as in vmaccess
+            aging_step(&lock, age, ref, VMEM_NFRAMES);
+        }
+        if (rep >= warmup) {
+            r->ns[r->reps++] = (double) (stats_now() - start) / ops;
+        }
+    }
+    sink += age[0];
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes a quantile of sorted values by linear
+ *              interpolation.
+ *
+ *  @param      v Sorted values.
+ *
+ *  @param      n Number of values, n > 0.
+ *
+ *  @param      q The quantile, 0 <= q <= 1.
+ *
+ *  @return     The quantile
+ ****************************************************************************************/
+static double quantile(const double *v, int n, double q) {
+    double pos = q * (n - 1);
+    int i = (int) pos;
+    return (i + 1 < n) ? v[i] + (pos - i) * (v[i + 1] - v[i]) : v[i];
+}
+
+void report(struct bench_result *r) {
+    double q1, med, q3;
+
+    if (r->reps == 0) {
+        return; // e.g. no page fault with the chosen parameters
+    }
+    qsort(r->ns, r->reps, sizeof(double), cmp_double);
+    q1 = quantile(r->ns, r->reps, 0.25);
+    med = quantile(r->ns, r->reps, 0.5);
+    q3 = quantile(r->ns, r->reps, 0.75);
+    if (format == BENCH_FORMAT_JSON) {
+        printf("{\"pagesize\":%d,\"algo\":\"%s\",\"case\":\"%s\",\"reps\":%d,\"median_ns\":%.2f,"
+               "\"q1_ns\":%.2f,\"q3_ns\":%.2f,\"iqr_ns\":%.2f,\"min_ns\":%.2f}\n",
+               VMEM_PAGESIZE, algo_names[page_rep_algo], r->name, r->reps, med, q1, q3, q3 - q1, r->ns[0]);
+    } else {
+        printf("%d,%s,%s,%d,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+               VMEM_PAGESIZE, algo_names[page_rep_algo], r->name, r->reps, med, q1, q3, q3 - q1, r->ns[0]);
+    }
+}
+
+void scan_params(int argc, char **argv) {
+    int i = 0;
+    unsigned char algo_param_found = FALSE;
+    unsigned char param_ok         = FALSE;
+    const char *reps_str = "-reps=";
+    const char *warmup_str = "-warmup=";
+    const char *ops_str = "-ops=";
+    const char *faults_str = "-faults=";
+    const char *threads_str = "-threads=";
+    const char *format_str = "-format=";
+    const char *instance_str = "-instance=";
+
+    // scan all parameters (argv[0] points to program name)
+    for (i = 1; i < argc; i++) {
+        param_ok = FALSE;
+        if (0 == strcasecmp("-fifo", argv[i]) || 0 == strcasecmp("-clock", argv[i]) ||
+            0 == strcasecmp("-aging", argv[i]) || 0 == strcasecmp("-lru", argv[i])) {
+            if (algo_param_found) print_usage_info_and_exit("Two page replacement algorithms selected.\n");
+            page_rep_algo = (0 == strcasecmp("-fifo", argv[i]))  ? VMEM_ALGO_FIFO :
+                            (0 == strcasecmp("-clock", argv[i])) ? VMEM_ALGO_CLOCK :
+                            (0 == strcasecmp("-aging", argv[i])) ? VMEM_ALGO_AGING : VMEM_ALGO_LRU;
+            algo_param_found = TRUE;
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(reps_str, argv[i], strlen(reps_str))) {
+            reps = atoi(argv[i] + strlen(reps_str));
+            if (reps < 1 || reps > BENCH_MAX_REPS) print_usage_info_and_exit("Invalid number of repetitions.\n");
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(warmup_str, argv[i], strlen(warmup_str))) {
+            warmup = atoi(argv[i] + strlen(warmup_str));
+            if (warmup < 0) print_usage_info_and_exit("Invalid number of warmup repetitions.\n");
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(ops_str, argv[i], strlen(ops_str))) {
+            ops = atol(argv[i] + strlen(ops_str));
+            if (ops < 1) print_usage_info_and_exit("Invalid number of operations.\n");
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(faults_str, argv[i], strlen(faults_str))) {
+            faults = atol(argv[i] + strlen(faults_str));
+            if (faults < 1) print_usage_info_and_exit("Invalid number of page faults.\n");
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(threads_str, argv[i], strlen(threads_str))) {
+            threads = atoi(argv[i] + strlen(threads_str));
+            if (threads < 1 || threads > BENCH_MAX_THREADS) print_usage_info_and_exit("Invalid number of threads.\n");
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(format_str, argv[i], strlen(format_str))) {
+            const char *f = argv[i] + strlen(format_str);
+            if (0 == strcasecmp(f, "csv")) {
+                format = BENCH_FORMAT_CSV;
+            } else if (0 == strcasecmp(f, "json")) {
+                format = BENCH_FORMAT_JSON;
+            } else {
+                print_usage_info_and_exit("Unknown output format.\n");
+            }
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-header", argv[i])) {
+            header = TRUE;
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(instance_str, argv[i], strlen(instance_str))) {
+            instance_init(argv[i] + strlen(instance_str));
+            param_ok = TRUE;
+        }
+        if (logger_option(argv[i])) {
+            // binary logfile
+            param_ok = TRUE;
+        }
+        if (pagefile_option(argv[i])) {
+            param_ok = TRUE;
+        }
+        if (!param_ok) print_usage_info_and_exit("Undefined parameter.\n"); // undefined parameter found
+    } // for loop
+}
+
+void print_usage_info_and_exit(char *err_str) {
+    fprintf(stderr, "Wrong parameter: %s\n", err_str);
+    fprintf(stderr, "Usage : %s [OPTIONS]\n", program_name);
+    fprintf(stderr, " -fifo | -clock | -aging | -lru : Page replacement algorithm\n");
+    fprintf(stderr, " -reps=<n> : Measured repetitions per case (default 21)\n");
+    fprintf(stderr, " -warmup=<n> : Repetitions before measurement (default 3)\n");
+    fprintf(stderr, " -ops=<n> : Operations per repetition of the hit, find_remove and update_age cases (default 1000000)\n");
+    fprintf(stderr, " -faults=<n> : Accesses per repetition of the fault cases (default 5000)\n");
+    fprintf(stderr, " -threads=<n> : Threads of the hit cases, each on a page of its own (default 1)\n");
+    fprintf(stderr, " -format=csv|json : Output format (default csv)\n");
+    fprintf(stderr, " -header : Print the CSV header line\n");
+    pagefile_usage();
+    logger_usage();
+    fprintf(stderr, " -instance=<id> : Instance id; the logfile will be logfile_<id>.txt\n");
+    fflush(stderr);
+    exit(EXIT_FAILURE);
+}
+
+// EOF
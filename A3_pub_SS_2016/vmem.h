@@ -8,6 +8,18 @@
  * Dec 2015 : Set memory algorithm vi command line parameter 
  * Dec 2015 : Set define for PAGESIZE and VMEM_ALGO via compiler -D option (Franz Korf, HAW Hamburg)
  * Dec 2015 : Add some documentation (Franz Korf, HAW Hamburg)
+ * Futex doorbell as alternative page fault notification
+ * Instance id for concurrent simulations, see instance.h
+ * Exact LRU page replacement, see lru.h
+ * Bitmap of free frames again, now as 64 bit words searched via count trailing zeros
+ * Ages and reference bits of resident pages per frame as packed byte arrays, see aging.h
+ * Background writeback of dirty pages by mmanage; PTF_DIRTY is set atomically after the store
+ * Latency histograms of the fault path in shared memory, see stats.h
+ * Live counters in shared memory for monitoring tools like vmtop
+ * Several clients with an address space (ASID) each share the frames, see struct vmem_client
+ * States of the frames, so worker threads of mmanage may serve page faults concurrently
+ * Several threads per client, each with a request slot of its own, see struct vmem_thread
+ * Pin counts of the frames for compound accesses like vmem_swap
  */
 
 #ifndef VMEM_H
@@ -26,12 +38,15 @@
 #include <sys/shm.h>
 
 #include "mytypes.h"
+#include "stats.h"
 
 #define SHMKEY          "./vmem.h" //!< First paremater for shared memory generation via ftok function
 #define SHMPROCID       1234       //!< Second paremater for shared memory generation via ftok function
 
 #define NAMED_SEM       "sem_vm_simulation_OS_X" //!< For OS-X semaphore
 
+#define VMEM_ATTACH_TIMEOUT 10000  //!< Time in ms vmaccess waits for mmanage to become ready
+
 /**
  * Constants for page replacement algorithms
  */
@@ -39,6 +54,21 @@
 #define VMEM_ALGO_FIFO  0
 #define VMEM_ALGO_AGING 1
 #define VMEM_ALGO_CLOCK 2
+#define VMEM_ALGO_LRU   3
+
+/**
+ * Constants for page fault notification of mmanage
+ */
+
+#define VMEM_NOTIFY_SIGNAL 0 //!< SIGUSR1 to mmanage, named semaphore for the answer
+#define VMEM_NOTIFY_FUTEX  1 //!< Futex doorbells in shared memory, see doorbell.h
+
+/**
+ * Constants for the scope of page replacement
+ */
+
+#define VMEM_SCOPE_GLOBAL 0 //!< The victim may be any frame
+#define VMEM_SCOPE_LOCAL  1 //!< A client that uses its share of the frames replaces its own pages
 
 // Following defines will be sets via compiler parameter / Makefile
 // VMEM_PAGESIZE :                    values 8 16 32 64
@@ -53,11 +83,31 @@
 #define VMEM_PAGESIZE 8
 #endif
 
+/**
+ * Constant VMEM_TLB_SIZE will be set via compiler -D option.
+ * Number of entries of the direct mapped translation cache of vmaccess.
+ * Default value : 8
+ * value range : power of 2
+ */
+#ifndef VMEM_TLB_SIZE
+#define VMEM_TLB_SIZE 8
+#endif
+
 /* Sizes */
 #define VMEM_VIRTMEMSIZE 1024   //!< Size of virtual address space of the process
 #define VMEM_PHYSMEMSIZE  128   //!< Size of physical memory
 #define VMEM_NPAGES     (VMEM_VIRTMEMSIZE / VMEM_PAGESIZE)  //!< Total number of pages 
 #define VMEM_NFRAMES (VMEM_PHYSMEMSIZE / VMEM_PAGESIZE)     //!< Total number of (page) frames 
+#define VMEM_NFRAMEWORDS ((VMEM_NFRAMES + 63) / 64)         //!< Number of 64 bit words of the free frame bitmap
+#define VMEM_MAXCLIENTS  64     //!< Max. number of clients, i.e. address spaces (ASID 0 .. VMEM_MAXCLIENTS - 1)
+#define VMEM_MAXTHREADS  256    //!< Max. number of threads of all clients that access the virtual memory
+#define VMEM_NGPAGES     (VMEM_MAXCLIENTS * VMEM_NPAGES)    //!< Pages of all address spaces
+
+/**
+ * Number of page page of address space asid in all address spaces. It is used by the pagefile
+ * and the logfile, so a single client (ASID 0) sees the page numbers of former versions.
+ */
+#define VMEM_GPAGE(asid, page) ((asid) * VMEM_NPAGES + (page))
 
 /**
  * page table flags used by this simulation
@@ -68,6 +118,17 @@
 
 #define VOID_IDX -1       //!< Constant for invalid page or frame reference 
 
+/**
+ * States of a frame. Pagefile I/O is done outside of the lock of mmcore.c, only 
+ * resident frames may be selected by the page replacement algorithms.
+ */
+#define FRAME_FREE      0 //!< unused frame
+#define FRAME_LOADING   1 //!< the requested page is being fetched from the pagefile
+#define FRAME_RESIDENT  2 //!< the frame stores a valid page
+#define FRAME_WRITING   3 //!< the modified victim is being written to the pagefile
+
+#define VMEM_CACHELINE 64 //!< Size of a cache line; counters of different writers are kept apart
+
 /**
  * Page table entry
  */
@@ -75,7 +136,7 @@ struct pt_entry {
    int flags;             //!< See definition of PTF_* flags 
    int frame;             //!< Frame idx; frame == VOID_IDX: unvalid reference  
    int count;             //!< Global counter as quasi-timestamp for LRU page replacement algorithm
-   unsigned char age;     //!< 8 bit counter for aging page replacement algorithm
+   unsigned char age;     //!< 8 bit counter for aging page replacement algorithm; see frame_age for resident pages
 };
 
 /**
@@ -85,23 +146,110 @@ struct vmem_adm_struct {
     int size;                    //!< size of virtual memory supported by mmanage
     pid_t mmanage_pid;           //!< process id if mmanage - will be used for sending signals to mmanage
     int shm_id;                  //!< shared memory id. Will be used to destroy shared memory when mmanage terminates
-    int req_pageno;              //!< number of requested page 
     int next_alloc_idx;          //!< next frame to allocate by FIFO and CLOCK page replacement algorithm
     int pf_count;                //!< page fault counter 
-    int g_count;                 //!< global acces counter as quasi-timestamp - will be increment by each memory access
     unsigned char page_rep_algo; // !< page replacement algorithm
+    unsigned char replace_scope; //!< scope of page replacement, see VMEM_SCOPE_*
+    int nclients;                //!< number of attached clients
+    unsigned char fault_notify;  //!< page fault notification mode, see VMEM_NOTIFY_*
+    int spin_max;                //!< max. number of polls of a doorbell before sleeping
+    int pf_request;              //!< doorbell rung by vmaccess on a page fault (VMEM_NOTIFY_FUTEX)
+    int ready;                   //!< set to TRUE by mmanage when it is ready to handle page faults
+    unsigned char membarrier;    //!< TRUE: mmanage forces the barriers of the clients by membarrier
+    unsigned long wb_sync;       //!< number of dirty pages written while handling a page fault
+    unsigned long wb_background; //!< number of dirty pages written by the background cleaner of mmanage
+    unsigned long pf_coalesced;  //!< number of page faults on a page that has just been loaded for another fault
     char *program_name;          //!< program name
 };
 
+/**
+ * A client of mmanage, i.e. a process using vmaccess. The index of its slot in 
+ * vmem_struct.clients is the ASID of its address space. A client claims a free slot 
+ * when it attaches and releases it when it terminates; the pages of the address 
+ * space stay in the frames and in the pagefile for the next client of this slot.
+ * Each slot is a cache line of its own, so clients don't disturb each other.
+ */
+struct vmem_client {
+    pid_t pid;                   //!< process id of the client; 0: unused slot
+    int nthreads;                //!< number of threads of the client that own a slot of vmem_struct.threads
+    int nframes;                 //!< number of frames that store pages of this address space
+    unsigned long hits;          //!< accesses to resident pages; added by each thread in batches
+    unsigned long faults;        //!< accesses that caused a page fault
+} __attribute__((aligned(VMEM_CACHELINE)));
+
+/**
+ * A thread of a client that accesses the virtual memory. A thread claims a free slot
+ * on its first access and releases it when it terminates. It posts its page faults 
+ * in its slot and will be answered via the semaphore or doorbell of the slot, so the
+ * threads of a client may wait for page faults at the same time.
+ * Each slot is a cache line of its own, so the hit paths of the threads don't 
+ * disturb each other.
+ */
+struct vmem_thread {
+    pid_t pid;                   //!< process id of the client; 0: unused slot
+    int asid;                    //!< address space of the client
+    int req_pageno;              //!< number of requested page 
+    int pf_pending;              //!< set by the thread when req_pageno has to be loaded, reset by mmanage
+    int pf_done;                 //!< doorbell rung by mmanage when the page fault has been handled
+    int inside;                  //!< TRUE while the thread accesses a frame, see vmaccess.c
+    int g_count;                 //!< acces counter of the thread as quasi-timestamp - will be increment by each memory access
+} __attribute__((aligned(VMEM_CACHELINE)));
+
+/**
+ * Live counters of mmanage, read by monitoring tools (see vmtop.c) while the simulation 
+ * runs. The counters of the clients are part of struct vmem_client.
+ * Each counter except dirty is written by mmanage while it holds the lock of
+ * mmcore.c only and will be updated via COUNTER_ADD without a locked instruction.
+ */
+struct vmem_counters {
+    unsigned long evictions __attribute__((aligned(VMEM_CACHELINE))); //!< pages removed from a frame
+    unsigned long evict_clean;   //!< evicted pages that had not been modified
+    unsigned long evict_dirty;   //!< evicted pages that had to be written to the pagefile
+    unsigned long pages_read;    //!< pages fetched from the pagefile
+    unsigned long pages_written; //!< pages written to the pagefile (evictions and background writeback)
+    unsigned long bytes_read;    //!< bytes fetched from the pagefile
+    unsigned long bytes_written; //!< bytes written to the pagefile
+    int resident;                //!< number of frames in use
+    /* vmaccess and mmanage */
+    int dirty __attribute__((aligned(VMEM_CACHELINE))); //!< number of resident pages with PTF_DIRTY
+};
+
+/**
+ * Adds n to a counter of struct vmem_counters that has a single writer.
+ * Readers in other processes never see a torn value.
+ */
+#define COUNTER_ADD(c, n) __atomic_store_n(&(c), __atomic_load_n(&(c), __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+
+/**
+ * Entry of the reverse map: the page stored in a frame
+ */
+struct rmap_entry {
+    int asid;              //!< address space of the page; VOID_IDX: unused frame
+    int page;              //!< page; VOID_IDX: unused frame
+};
+
 /**
  * This structure contains
-   - page table 
-   - mapping form frame idx to page idx (for each frame the page stored in this frame currently
+   - page tables of all address spaces
+   - reverse map from frame idx to (ASID, page idx) (for each frame the page stored in this frame currently)
  */
 struct pt_struct {
     /* page table */
-    struct pt_entry entries[VMEM_NPAGES]; //!< page table 
-    int framepage[VMEM_NFRAMES];          //!< Gives for each fame the page stored in this frame.  VOID_IDX indicates an unused frame.A
+    struct pt_entry entries[VMEM_MAXCLIENTS][VMEM_NPAGES]; //!< page table of each address space
+    struct rmap_entry rmap[VMEM_NFRAMES]; //!< Gives for each fame the page stored in this frame.
+    unsigned int framegen[VMEM_NFRAMES];  //!< Generation of each frame. Incremented when a page is removed from the frame.
+    unsigned int frame_loaded[VMEM_NFRAMES]; //!< pf_count when the page of each frame has been loaded (local FIFO)
+    int lru_prev[VMEM_NFRAMES];           //!< LRU list: next less recently used frame; VOID_IDX at the head
+    int lru_next[VMEM_NFRAMES];           //!< LRU list: next more recently used frame; VOID_IDX at the tail
+    int lru_head;                         //!< LRU list: least recently used frame; VOID_IDX: empty list
+    int lru_tail;                         //!< LRU list: most recently used frame
+    int lru_lock;                         //!< LRU list: spin lock, see lru_lock
+    unsigned long long freeframes[VMEM_NFRAMEWORDS]; //!< Bit i of word i/64 is set if frame i is unused
+    int aging_lock;                       //!< Aging: spin lock of frame_age, see aging_lock
+    unsigned char frame_age[VMEM_NFRAMES];   //!< Aging: age of the page stored in each frame
+    unsigned char frame_ref[VMEM_NFRAMES];   //!< Aging: reference bit (AGING_REF) of the page stored in each frame
+    unsigned char frame_state[VMEM_NFRAMES]; //!< State of each frame, see FRAME_*
+    unsigned short frame_pins[VMEM_NFRAMES]; //!< Number of compound accesses (vmem_swap) that pinned each frame
 };
 
 /* This is to be located in shared memory */
@@ -110,7 +258,11 @@ struct pt_struct {
  */
 struct vmem_struct {
     struct vmem_adm_struct adm;              //!< admin data
+    struct vmem_counters counters;           //!< live counters
+    struct vmem_client clients[VMEM_MAXCLIENTS]; //!< clients, index: ASID
+    struct vmem_thread threads[VMEM_MAXTHREADS]; //!< threads of all clients
     struct pt_struct pt;                     //!< page table 
+    struct vmem_stats stats;                 //!< latency histograms of the fault path
     int data[VMEM_NFRAMES * VMEM_PAGESIZE];  //!< main memory used by virtual memory simulation 
 };
 
@@ -121,7 +273,8 @@ struct vmem_struct {
 /**
  * UPDATE_AGE_COUNT will be used by aging page replacement algorithm. 
  * When (g_count % UPDATE_AGE_COUNT) == 0 : UPDATE_AGE_COUNT quasi time units has passed
- * and aging algorithm will be executed. 
+ * and aging algorithm will be executed. Each thread of a client counts its own accesses, 
+ * so the frames age faster when more clients or threads are running. 
  */
 #define UPDATE_AGE_COUNT   20
 
@@ -0,0 +1,167 @@
+/**
+ * @file vmreplay.c
+ * @brief Replay of an address trace recorded by vmaccess (see vmem_trace).
+ *
+ * The accesses of the trace will be fed into the in-process simulation
+ * (vmem_init_inproc), so the page replacement algorithms of mmcore.c
+ * write the same logfile as mmanage would for the recorded application.
+ * An application has to be run only once per seed; the trace can then be 
+ * replayed for every page replacement algorithm and page size.
+ *
+ * With -mrc=<file> the trace will not be simulated. Instead the miss ratio
+ * curves of all page sizes and sizes of physical memory will be computed
+ * in one pass (see mrc.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vmaccess.h"
+#include "vmem.h"
+#include "instance.h"
+#include "pagefile.h"
+#include "logger.h"
+#include "trace.h"
+#include "mrc.h"
+#include "mytypes.h"
+
+/* 
+ * Signatures of private (static) functions of this module.
+ */
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans all parameters of the program.
+ *              The corresponding static variables will be set.
+ * 
+ *  @param      argc number of parameter 
+ *
+ *  @param      argv parameter list 
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void scan_params(int argc, char **argv);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints an error message and the usage information of 
+ *              this program.
+ *
+ *  @param      err_str pointer to the error string that should be printed.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void print_usage_info_and_exit(char *err_str);
+
+/*
+ * static global variables
+ */
+static char *program_name = NULL;
+static char *trace_name   = NULL;            // trace file to be replayed
+static int page_rep_algo  = VMEM_ALGO_FIFO;  // page replacement algorithm
+static char *mrc_name     = NULL;            // miss ratio curve file; NULL: simulate the trace
+
+int main(int argc, char **argv) {
+    struct trace_reader tr;
+    int address, is_write, g_count;
+    long n = 0;
+    int first_g_count = 0;
+
+    program_name = argv[0];
+    scan_params(argc, argv);
+    if (trace_name == NULL) print_usage_info_and_exit("No trace file.\n");
+
+    trace_reader_open(&tr, trace_name);
+    if (mrc_name != NULL) {
+        mrc_open(mrc_name);
+        while (trace_next(&tr, &address, &is_write, &g_count)) {
+            mrc_access(address, g_count);
+            n++;
+        }
+        trace_reader_close(&tr);
+        printf("%ld accesses analyzed\n", n);
+        return 0;
+    }
+    vmem_init_inproc(page_rep_algo);
+    while (trace_next(&tr, &address, &is_write, &g_count)) {
+        if (n == 0) {
+            first_g_count = g_count;
+        }
+        if (g_count != first_g_count + n) {
+            fprintf(stderr, "Warning: access %ld has global count %d, replayed as %ld\n", 
+                    n, g_count, first_g_count + n);
+            first_g_count = g_count - n;
+        }
+        if (is_write) {
+            vmem_write(address, 0);
+        } else {
+            vmem_read(address);
+        }
+        n++;
+    }
+    trace_reader_close(&tr);
+    printf("%ld accesses replayed\n", n);
+    return 0;
+}
+
+void scan_params(int argc, char **argv) {
+    int i = 0;
+    unsigned char algo_param_found = FALSE;
+    unsigned char param_ok         = FALSE;
+    const char *trace_str = "-trace=";
+    const char *instance_str = "-instance=";
+    const char *mrc_str = "-mrc=";
+
+    // scan all parameters (argv[0] points to program name)
+    for (i = 1; i < argc; i++) {
+        param_ok = FALSE;
+        if (0 == strcasecmp("-fifo", argv[i]) || 0 == strcasecmp("-clock", argv[i]) || 
+            0 == strcasecmp("-aging", argv[i]) || 0 == strcasecmp("-lru", argv[i])) {
+            if (algo_param_found) print_usage_info_and_exit("Two page replacement algorithms selected.\n");
+            page_rep_algo = (0 == strcasecmp("-fifo", argv[i]))  ? VMEM_ALGO_FIFO :
+                            (0 == strcasecmp("-clock", argv[i])) ? VMEM_ALGO_CLOCK :
+                            (0 == strcasecmp("-aging", argv[i])) ? VMEM_ALGO_AGING : VMEM_ALGO_LRU;
+            algo_param_found = TRUE;
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(trace_str, argv[i], strlen(trace_str))) {
+            trace_name = argv[i] + strlen(trace_str);
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(mrc_str, argv[i], strlen(mrc_str))) {
+            mrc_name = argv[i] + strlen(mrc_str);
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(instance_str, argv[i], strlen(instance_str))) {
+            instance_init(argv[i] + strlen(instance_str));
+            param_ok = TRUE;
+        }
+        if (mrc_option(argv[i])) {
+            param_ok = TRUE;
+        }
+        if (logger_option(argv[i])) {
+            // binary logfile
+            param_ok = TRUE;
+        }
+        if (pagefile_option(argv[i])) {
+            param_ok = TRUE;
+        }
+        if (!param_ok) print_usage_info_and_exit("Undefined parameter.\n"); // undefined parameter found
+    } // for loop
+}
+
+void print_usage_info_and_exit(char *err_str) {
+    fprintf(stderr, "Wrong parameter: %s\n", err_str);
+    fprintf(stderr, "Usage : %s -trace=<file> [OPTIONS]\n", program_name);
+    fprintf(stderr, " -trace=<file> : Address trace to be replayed\n");
+    fprintf(stderr, " -fifo | -clock | -aging | -lru : Page replacement algorithm\n");
+    fprintf(stderr, " -mrc=<file> : Don't simulate, write the miss ratio curves of the trace to <file> (CSV)\n");
+    mrc_usage();
+    pagefile_usage();
+    logger_usage();
+    fprintf(stderr, " -instance=<id> : Instance id; the logfile will be logfile_<id>.txt\n");
+    fflush(stderr);
+    exit(EXIT_FAILURE);
+}
+
+// EOF
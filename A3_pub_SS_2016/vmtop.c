@@ -0,0 +1,217 @@
+/**
+ * @file vmtop.c
+ * @brief Monitor of a running simulation.
+ *
+ * vmtop attaches read-only to the shared memory of mmanage and prints the
+ * live counters (see struct vmem_counters and struct vmem_client in vmem.h) 
+ * once per interval: rates per second of accesses and page faults of all
+ * clients, evictions and pagefile I/O together with the number of resident 
+ * and dirty frames and of clients, e.g.
+ *
+ *     ./vmtop -interval=0.5
+ *
+ * vmtop terminates when mmanage has removed the shared memory.
+ */
+
+#include <time.h>
+#include "vmem.h"
+#include "instance.h"
+#include "debug.h"
+#include "mytypes.h"
+
+#define VMTOP_HEADER_LINES 20 //!< The column header will be repeated after this number of lines
+
+/**
+ * Counters of mmanage and sums of the counters of all clients
+ */
+struct vmtop_sample {
+    struct vmem_counters c;  //!< counters of mmanage
+    unsigned long hits;      //!< accesses to resident pages of all clients
+    unsigned long faults;    //!< page faults of all clients
+    int clients;             //!< number of attached clients
+};
+
+/*
+ * Signatures of private (static) functions of this module.
+ */
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans all parameters of the program.
+ *              The corresponding static variables will be set.
+ *
+ *  @param      argc number of parameter
+ *
+ *  @param      argv parameter list
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void scan_params(int argc, char **argv);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints an error message and the usage information of
+ *              this program.
+ *
+ *  @param      err_str pointer to the error string that should be printed.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void print_usage_info_and_exit(char *err_str);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function attaches read-only to the shared memory of mmanage.
+ *              It waits up to VMEM_ATTACH_TIMEOUT ms for mmanage to create it.
+ *
+ *  @param      shmid Receives the id of the shared memory.
+ *
+ *  @return     The virtual memory of the simulation
+ ****************************************************************************************/
+static const struct vmem_struct *attach(int *shmid);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function copies all counters. Each counter is read atomically.
+ *
+ *  @param      dst The copy.
+ *
+ *  @param      vmem The virtual memory in shared memory.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void snapshot(struct vmtop_sample *dst, const struct vmem_struct *vmem);
+
+/*
+ * static global variables
+ */
+static char *program_name = NULL;
+static double interval    = 1.0;  // seconds between two lines
+static long count         = -1;   // number of lines; -1: until mmanage terminates
+
+int main(int argc, char **argv) {
+    const struct vmem_struct *vmem;
+    struct vmtop_sample prev, cur;
+    struct timespec delay, t0, t1;
+    struct shmid_ds ds;
+    unsigned long accesses;
+    double dt;
+    long line;
+    int shmid;
+
+    program_name = argv[0];
+    scan_params(argc, argv);
+    vmem = attach(&shmid);
+
+    delay.tv_sec = (time_t) interval;
+    delay.tv_nsec = (long) ((interval - delay.tv_sec) * 1e9);
+    snapshot(&prev, vmem);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (line = 0; count < 0 || line < count; line++) {
+        nanosleep(&delay, NULL);
+        snapshot(&cur, vmem);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        dt = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+        if (line % VMTOP_HEADER_LINES == 0) {
+            printf("%12s %10s %8s %9s %9s %9s %9s %9s %10s %10s %5s %5s %4s\n",
+                   "access/s", "fault/s", "miss%", "evict/s", "clean/s", "dirty/s",
+                   "read/s", "write/s", "rKB/s", "wKB/s", "res", "dirty", "cl");
+        }
+        accesses = (cur.hits - prev.hits) + (cur.faults - prev.faults);
+        printf("%12.0f %10.0f %8.3f %9.0f %9.0f %9.0f %9.0f %9.0f %10.1f %10.1f %5d %5d %4d\n",
+               accesses / dt, (cur.faults - prev.faults) / dt,
+               accesses ? 100.0 * (cur.faults - prev.faults) / accesses : 0.0,
+               (cur.c.evictions - prev.c.evictions) / dt, (cur.c.evict_clean - prev.c.evict_clean) / dt,
+               (cur.c.evict_dirty - prev.c.evict_dirty) / dt, (cur.c.pages_read - prev.c.pages_read) / dt,
+               (cur.c.pages_written - prev.c.pages_written) / dt,
+               (cur.c.bytes_read - prev.c.bytes_read) / dt / 1024,
+               (cur.c.bytes_written - prev.c.bytes_written) / dt / 1024,
+               cur.c.resident, cur.c.dirty, cur.clients);
+        fflush(stdout);
+
+        // mmanage marks the shared memory for destruction when it terminates
+        if (shmctl(shmid, IPC_STAT, &ds) == -1 || (ds.shm_perm.mode & SHM_DEST)) {
+            break;
+        }
+        prev = cur;
+        t0 = t1;
+    }
+    shmdt(vmem);
+    return 0;
+}
+
+const struct vmem_struct *attach(int *shmid) {
+    void *shmdata;
+    int waited = 0;
+
+    instance_init(NULL);
+    while ((*shmid = shmget(instance_shm_key(), SHMSIZE, SHM_R)) == -1) {
+        TEST_AND_EXIT_ERRNO(errno != ENOENT || waited++ >= VMEM_ATTACH_TIMEOUT, "Error attaching shared memory");
+        usleep(1000);
+    }
+    shmdata = shmat(*shmid, NULL, SHM_RDONLY);
+    TEST_AND_EXIT_ERRNO(shmdata == (void *) -1, "Error attaching shared memory");
+    return (const struct vmem_struct *) shmdata;
+}
+
+void snapshot(struct vmtop_sample *dst, const struct vmem_struct *vmem) {
+    const struct vmem_counters *src = &vmem->counters;
+    int i;
+
+    dst->c.evictions     = __atomic_load_n(&src->evictions, __ATOMIC_RELAXED);
+    dst->c.evict_clean   = __atomic_load_n(&src->evict_clean, __ATOMIC_RELAXED);
+    dst->c.evict_dirty   = __atomic_load_n(&src->evict_dirty, __ATOMIC_RELAXED);
+    dst->c.pages_read    = __atomic_load_n(&src->pages_read, __ATOMIC_RELAXED);
+    dst->c.pages_written = __atomic_load_n(&src->pages_written, __ATOMIC_RELAXED);
+    dst->c.bytes_read    = __atomic_load_n(&src->bytes_read, __ATOMIC_RELAXED);
+    dst->c.bytes_written = __atomic_load_n(&src->bytes_written, __ATOMIC_RELAXED);
+    dst->c.resident      = __atomic_load_n(&src->resident, __ATOMIC_RELAXED);
+    dst->c.dirty         = __atomic_load_n(&src->dirty, __ATOMIC_RELAXED);
+    dst->hits = 0;
+    dst->faults = 0;
+    for (i = 0; i < VMEM_MAXCLIENTS; i++) {
+        dst->hits   += __atomic_load_n(&vmem->clients[i].hits, __ATOMIC_RELAXED);
+        dst->faults += __atomic_load_n(&vmem->clients[i].faults, __ATOMIC_RELAXED);
+    }
+    dst->clients = __atomic_load_n(&vmem->adm.nclients, __ATOMIC_RELAXED);
+}
+
+void scan_params(int argc, char **argv) {
+    int i = 0;
+    unsigned char param_ok = FALSE;
+    const char *interval_str = "-interval=";
+    const char *count_str = "-count=";
+    const char *instance_str = "-instance=";
+
+    // scan all parameters (argv[0] points to program name)
+    for (i = 1; i < argc; i++) {
+        param_ok = FALSE;
+        if (0 == strncasecmp(interval_str, argv[i], strlen(interval_str))) {
+            interval = atof(argv[i] + strlen(interval_str));
+            if (interval <= 0) print_usage_info_and_exit("Interval must be positive.\n");
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(count_str, argv[i], strlen(count_str))) {
+            count = atol(argv[i] + strlen(count_str));
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp(instance_str, argv[i], strlen(instance_str))) {
+            instance_init(argv[i] + strlen(instance_str));
+            param_ok = TRUE;
+        }
+        if (!param_ok) print_usage_info_and_exit("Undefined parameter.\n"); // undefined parameter found
+    } // for loop
+}
+
+void print_usage_info_and_exit(char *err_str) {
+    fprintf(stderr, "Wrong parameter: %s\n", err_str);
+    fprintf(stderr, "Usage : %s [OPTIONS]\n", program_name);
+    fprintf(stderr, " -interval=<s> : Seconds between two lines (default 1)\n");
+    fprintf(stderr, " -count=<n> : Print n lines and terminate (default: until mmanage terminates)\n");
+    fprintf(stderr, " -instance=<id> : Monitor the simulation with instance id <id>\n");
+    fflush(stderr);
+    exit(EXIT_FAILURE);
+}
+
+// EOF
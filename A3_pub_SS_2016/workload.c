@@ -0,0 +1,212 @@
+/**
+ * @file workload.c
+ * @brief This module implements the synthetic workloads of vmappl.
+ *        See workload.h for the access patterns.
+ */
+
+#include <math.h>
+#include "vmem.h"
+#include "vmaccess.h"
+#include "workload.h"
+#include "debug.h"
+#include "mytypes.h"
+
+/**
+ * Names of the workloads, index WORKLOAD_*
+ */
+static const char *workload_names[] = { "none", "seq", "stride", "random", "zipf", "loop", "phase" };
+
+/*
+ * static variables: parameters of the workload
+ */
+static int workload  = WORKLOAD_NONE;
+static long ops      = WORKLOAD_OPS;                        //!< number of accesses
+static int footprint = VMEM_VIRTMEMSIZE;                    //!< accessed ints: addresses 0 .. footprint - 1
+static int writes    = 0;                                   //!< percentage of writes
+static int stride    = VMEM_PAGESIZE;                       //!< stride in ints (stride)
+static double skew   = 0.99;                                //!< exponent of the Zipf distribution (zipf)
+static int loop_size = VMEM_PHYSMEMSIZE + VMEM_PAGESIZE;    //!< size of the scanned region in ints (loop)
+static int wss       = VMEM_PHYSMEMSIZE / 2;                //!< size of the working set in ints (phase)
+static long phase    = 10000;                               //!< accesses per phase (phase)
+
+static unsigned long long rng_state = 0; //!< State of SplitMix64
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the next random number of SplitMix64.
+ *
+ *  @return     64 bit random number
+ ****************************************************************************************/
+static unsigned long long rng_next(void) {
+    unsigned long long z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns a uniformly distributed random number.
+ *
+ *  @return     Random number in [0, 1)
+ ****************************************************************************************/
+static double rng_uniform(void) {
+    return (rng_next() >> 11) * (1.0 / 9007199254740992.0); // 53 bit mantissa
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns a uniformly distributed random integer.
+ *
+ *  @param      n Upper bound, n > 0.
+ *
+ *  @return     Random number in [0, n)
+ ****************************************************************************************/
+static int rng_below(int n) {
+    return (int) (rng_uniform() * n);
+}
+
+int workload_option(const char *arg) {
+    const char *workload_str = "-workload=";
+    const char *ops_str = "-ops=";
+    const char *footprint_str = "-footprint=";
+    const char *writes_str = "-writes=";
+    const char *stride_str = "-stride=";
+    const char *skew_str = "-skew=";
+    const char *loop_str = "-loop=";
+    const char *wss_str = "-wss=";
+    const char *phase_str = "-phase=";
+    int i;
+
+    if (0 == strncasecmp(workload_str, arg, strlen(workload_str))) {
+        for (i = WORKLOAD_SEQ; i <= WORKLOAD_PHASE; i++) {
+            if (0 == strcasecmp(workload_names[i], arg + strlen(workload_str))) {
+                workload = i;
+                return TRUE;
+            }
+        }
+        return FALSE;
+    }
+    if (0 == strncasecmp(ops_str, arg, strlen(ops_str))) {
+        return 1 == sscanf(arg + strlen(ops_str), "%ld", &ops) && ops >= 0;
+    }
+    if (0 == strncasecmp(footprint_str, arg, strlen(footprint_str))) {
+        return 1 == sscanf(arg + strlen(footprint_str), "%d", &footprint) &&
+               footprint > 0 && footprint <= VMEM_VIRTMEMSIZE;
+    }
+    if (0 == strncasecmp(writes_str, arg, strlen(writes_str))) {
+        return 1 == sscanf(arg + strlen(writes_str), "%d", &writes) && writes >= 0 && writes <= 100;
+    }
+    if (0 == strncasecmp(stride_str, arg, strlen(stride_str))) {
+        return 1 == sscanf(arg + strlen(stride_str), "%d", &stride) && stride > 0;
+    }
+    if (0 == strncasecmp(skew_str, arg, strlen(skew_str))) {
+        return 1 == sscanf(arg + strlen(skew_str), "%lf", &skew) && skew >= 0;
+    }
+    if (0 == strncasecmp(loop_str, arg, strlen(loop_str))) {
+        return 1 == sscanf(arg + strlen(loop_str), "%d", &loop_size) && loop_size > 0;
+    }
+    if (0 == strncasecmp(wss_str, arg, strlen(wss_str))) {
+        return 1 == sscanf(arg + strlen(wss_str), "%d", &wss) && wss > 0;
+    }
+    if (0 == strncasecmp(phase_str, arg, strlen(phase_str))) {
+        return 1 == sscanf(arg + strlen(phase_str), "%ld", &phase) && phase > 0;
+    }
+    return FALSE;
+}
+
+void workload_usage(void) {
+    fprintf(stderr, " -workload=seq|stride|random|zipf|loop|phase : Run a synthetic workload instead of sorting\n");
+    fprintf(stderr, " -ops=<n> : Number of accesses of the workload (default %d)\n", WORKLOAD_OPS);
+    fprintf(stderr, " -footprint=<n> : The workload accesses the ints 0 .. <n>-1 (default %d)\n", VMEM_VIRTMEMSIZE);
+    fprintf(stderr, " -writes=<percent> : Percentage of writes of the workload (default 0)\n");
+    fprintf(stderr, " -stride=<n> : Stride of -workload=stride in ints (default %d)\n", VMEM_PAGESIZE);
+    fprintf(stderr, " -skew=<s> : Exponent of -workload=zipf (default 0.99)\n");
+    fprintf(stderr, " -loop=<n> : Ints scanned by -workload=loop (default %d)\n", VMEM_PHYSMEMSIZE + VMEM_PAGESIZE);
+    fprintf(stderr, " -wss=<n> : Working set of -workload=phase in ints (default %d)\n", VMEM_PHYSMEMSIZE / 2);
+    fprintf(stderr, " -phase=<n> : Accesses per phase of -workload=phase (default 10000)\n");
+}
+
+int workload_selected(void) {
+    return workload;
+}
+
+void workload_run(int seed) {
+    static double cdf[VMEM_NPAGES];   // zipf: cumulative weights of the pages
+    int npages = (footprint + VMEM_PAGESIZE - 1) / VMEM_PAGESIZE;
+    int region = (loop_size < footprint) ? loop_size : footprint;
+    int set = (wss < footprint) ? wss : footprint;
+    int lanes = (stride < footprint) ? stride : footprint;
+    unsigned long checksum = 0;
+    long nwrites = 0;
+    int base = 0;
+    int lane = 0;
+    int address = 0;
+    long i;
+    int k;
+
+    rng_state = (unsigned long long) seed;
+    if (workload == WORKLOAD_ZIPF) {
+        for (k = 0; k < npages; k++) {
+            cdf[k] = ((k > 0) ? cdf[k - 1] : 0) + 1.0 / pow(k + 1, skew);
+        }
+    }
+    for (i = 0; i < ops; i++) {
+        switch (workload) {
+        case WORKLOAD_SEQ:
+            address = i % footprint;
+            break;
+        case WORKLOAD_STRIDE:
+            if (i > 0) {
+                address += stride;
+                if (address >= footprint) {
+                    lane = (lane + 1) % lanes; // next pass starts one int later
+                    address = lane;
+                }
+            }
+            break;
+        case WORKLOAD_RANDOM:
+            address = rng_below(footprint);
+            break;
+        case WORKLOAD_ZIPF: {
+            double u = rng_uniform() * cdf[npages - 1];
+            int lo = 0;
+            int hi = npages - 1;
+            while (lo < hi) {       // first page with cdf >= u
+                int mid = (lo + hi) / 2;
+                if (cdf[mid] < u) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            address = lo * VMEM_PAGESIZE + rng_below(VMEM_PAGESIZE);
+            if (address >= footprint) {
+                address = footprint - 1;
+            }
+            break;
+        }
+        case WORKLOAD_LOOP:
+            address = i % region;
+            break;
+        case WORKLOAD_PHASE:
+            if (i % phase == 0) {
+                base = rng_below(footprint - set + 1);
+            }
+            address = base + rng_below(set);
+            break;
+        default:
+            TEST_AND_EXIT(TRUE, (stderr, "workload_run: no workload selected\n"));
+        }
+        if (writes > 0 && rng_below(100) < writes) {
+            vmem_write(address, (int) i);
+            nwrites++;
+        } else {
+            checksum += (unsigned int) vmem_read(address);
+        }
+    }
+    printf("workload = %s ops = %ld reads = %ld writes = %ld checksum = %lu\n",
+           workload_names[workload], ops, ops - nwrites, nwrites, checksum);
+}
+
+// EOF
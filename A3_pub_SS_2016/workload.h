@@ -0,0 +1,73 @@
+/**
+ * @file workload.h
+ * @brief Header file of the workload module: synthetic access patterns of vmappl.
+ *
+ * Instead of sorting an array, vmappl may run a synthetic workload that
+ * accesses the virtual memory with a parameterized pattern:
+ *
+ *   seq     sequential scan of the footprint, repeated
+ *   stride  scan of the footprint with a fixed stride
+ *   random  uniformly distributed accesses to the footprint
+ *   zipf    Zipf distributed pages of the footprint (page 0 is the hottest one),
+ *           uniformly distributed offsets inside the page
+ *   loop    sequential scan of a region that is larger than physical memory
+ *   phase   uniformly distributed accesses to a working set that moves to a
+ *           new random location of the footprint after each phase
+ *
+ * Each access is a write with a configurable probability, otherwise a read.
+ * The random numbers are generated by SplitMix64, seeded with the seed of vmappl,
+ * so a workload is reproducible.
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#define WORKLOAD_NONE   0 //!< no workload selected: vmappl sorts
+#define WORKLOAD_SEQ    1
+#define WORKLOAD_STRIDE 2
+#define WORKLOAD_RANDOM 3
+#define WORKLOAD_ZIPF   4
+#define WORKLOAD_LOOP   5
+#define WORKLOAD_PHASE  6
+
+#define WORKLOAD_OPS 100000 //!< Default number of accesses
+
+/**
+ *****************************************************************************************
+ *  @brief      This function scans one command line parameter of the workload module.
+ *              See workload_usage for the parameters.
+ *
+ *  @param      arg The parameter.
+ *
+ *  @return     TRUE if arg is a valid parameter of the workload module, otherwise FALSE.
+ ****************************************************************************************/
+int workload_option(const char *arg);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the usage information of the parameters
+ *              scanned by workload_option to stderr.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void workload_usage(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the selected workload.
+ *
+ *  @return     WORKLOAD_NONE if no workload has been selected, otherwise WORKLOAD_*
+ ****************************************************************************************/
+int workload_selected(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function runs the selected workload and prints a summary to stdout.
+ *
+ *  @param      seed Seed of the random number generator.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void workload_run(int seed);
+
+#endif /* WORKLOAD_H */